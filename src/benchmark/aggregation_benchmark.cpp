@@ -0,0 +1,102 @@
+#include "hash_aggregation.hpp"
+#include "prefetching.hpp"
+
+#include <random>
+#include <chrono>
+#include <nlohmann/json.hpp>
+#include <fstream>
+
+#include "zipfian_int_distribution.cpp"
+
+template <typename Distribution>
+void generate_rows(std::vector<uint32_t> &keys, std::vector<uint32_t> &values, std::mt19937 &gen, Distribution dis)
+{
+    std::uniform_int_distribution<uint32_t> value_dis(0, 1'000'000);
+    for (size_t row = 0; row < keys.size(); ++row)
+    {
+        keys[row] = dis(gen);
+        values[row] = value_dis(gen);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    auto &benchmark_config = Prefetching::get().runtime_config;
+    // clang-format off
+    benchmark_config.add_options()
+        ("number_rows", "Number of input rows", cxxopts::value<std::vector<size_t>>()->default_value("25000000"))
+        ("number_groups", "Number of distinct keys the rows are drawn from", cxxopts::value<std::vector<size_t>>()->default_value("1000000"))
+        ("d,distribution", "Distribution of the keys over the groups (uniform, zipfian)", cxxopts::value<std::vector<std::string>>()->default_value("uniform,zipfian"))
+        ("skew", "Skew (theta) of the zipfian distribution", cxxopts::value<std::vector<double>>()->default_value("0.99"))
+        ("technique", "Update technique (plain, amac, coroutine)", cxxopts::value<std::vector<std::string>>()->default_value("plain,amac,coroutine"))
+        ("t,threads", "Number of threads, each aggregates into its own partial table", cxxopts::value<std::vector<size_t>>()->default_value("1"))
+        ("group_size", "Number of interleaved updates", cxxopts::value<std::vector<int>>()->default_value("32"))
+        ("batch_size", "Number of rows handed to the interleaved updates at once", cxxopts::value<std::vector<size_t>>()->default_value("1024"));
+    // clang-format on
+    benchmark_config.parse(argc, argv);
+
+    int benchmark_run = 0;
+    for (auto &runtime_config : benchmark_config.get_runtime_configs())
+    {
+        auto number_rows = convert<size_t>(runtime_config["number_rows"]);
+        auto number_groups = convert<size_t>(runtime_config["number_groups"]);
+        auto technique = parse_aggregation_technique(runtime_config["technique"]);
+        auto threads = convert<size_t>(runtime_config["threads"]);
+        auto group_size = convert<int>(runtime_config["group_size"]);
+        auto batch_size = convert<size_t>(runtime_config["batch_size"]);
+
+        std::random_device rd;
+        std::mt19937 gen(rd());
+
+        std::vector<uint32_t> keys(number_rows);
+        std::vector<uint32_t> values(number_rows);
+        if (runtime_config["distribution"] == "uniform")
+        {
+            generate_rows(keys, values, gen, std::uniform_int_distribution<uint32_t>(0, number_groups - 1));
+        }
+        else if (runtime_config["distribution"] == "zipfian")
+        {
+            generate_rows(keys, values, gen, zipfian_int_distribution<int>(0, number_groups - 1, convert<double>(runtime_config["skew"])));
+        }
+        else
+        {
+            std::cout << "Unknown Distribution Defined: " << runtime_config["distribution"] << std::endl;
+            continue;
+        }
+
+        PrefetchProfiler profiler{30};
+        HashAggregation<uint32_t, uint32_t> aggregation{threads, number_groups / threads, profiler};
+
+        auto start = std::chrono::high_resolution_clock::now();
+        auto groups = aggregation.aggregate(keys, values, technique, group_size, batch_size);
+        auto end = std::chrono::high_resolution_clock::now();
+        double time = std::chrono::duration<double>(end - start).count();
+
+        uint64_t total_count = 0;
+        for (auto &[key, aggregate] : groups)
+        {
+            total_count += aggregate.count;
+        }
+        if (total_count != number_rows)
+        {
+            std::cout << "Aggregated " << total_count << " rows, expected " << number_rows << std::endl;
+        }
+
+        std::cout << std::endl;
+        std::cout << runtime_config["technique"] << " " << runtime_config["distribution"] << " threads: " << threads << std::endl;
+        std::cout << "Total time taken: " << time << " seconds" << std::endl;
+        std::cout << "Throughput: " << number_rows / time << " rows/second" << std::endl;
+        std::cout << "Groups: " << groups.size() << std::endl;
+
+        nlohmann::json results;
+        results["config"] = runtime_config;
+        results["time"] = time;
+        results["throughput"] = number_rows / time;
+        results["groups"] = groups.size();
+
+        auto results_file = std::ofstream{"aggregation_benchmark_" + std::to_string(benchmark_run++) + ".json"};
+        results_file << results.dump(-1) << std::flush;
+    }
+
+    return 0;
+}
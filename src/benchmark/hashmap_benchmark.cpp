@@ -1,4 +1,12 @@
 #include "hashmap.hpp"
+#include "bucketed_hashmap.hpp"
+#include "swiss_hashmap.hpp"
+#include "cuckoo_hashmap.hpp"
+#include "compact_hashmap.hpp"
+#include "concurrent_hashmap.hpp"
+#include "sharded_hashmap.hpp"
+#include "adaptive_dispatcher.hpp"
+#include "page_reorder.hpp"
 #include "prefetching.hpp"
 
 #include <random>
@@ -7,30 +15,85 @@
 #include <assert.h>
 #include <nlohmann/json.hpp>
 #include <fstream>
+#include <thread>
+#include <atomic>
+#include <string>
 
 #include "zipfian_int_distribution.cpp"
 #include "numa/static_numa_memory_resource.hpp"
+#include "utils/utils.cpp"
 
 const int TOTAL_QUERIES = 25'000'000;
 const int GROUP_SIZE = 32;
 const int AMAC_REQUESTS_SIZE = 1024;
 
-template <typename Function>
-void measure_vectorized_operation(HashMap<uint32_t, uint32_t> &openMap, Function func, const std::string &op_name, int invoke_vector_size, auto gen, auto dis, nlohmann::json &metrics)
+struct PairKey
+{
+    uint64_t first;
+    uint64_t second;
+
+    bool operator==(const PairKey &) const = default;
+};
+
+template <>
+struct std::hash<PairKey>
+{
+    size_t operator()(const PairKey &key) const
+    {
+        uint64_t h = key.first * 0x9E3779B97F4A7C15ull ^ key.second;
+        return h ^ (h >> 32);
+    }
+};
+
+/*
+    Every key type is generated from a dense id, the value stored for a key is always id + 1. Ids at or above the
+    number of keys are never inserted.
+*/
+template <typename K>
+K make_key(uint32_t id);
+
+template <>
+uint32_t make_key(uint32_t id) { return id; }
+
+template <>
+uint64_t make_key(uint32_t id) { return id * 0x9E3779B97F4A7C15ull; }
+
+template <>
+PairKey make_key(uint32_t id) { return {id, id * 0x9E3779B97F4A7C15ull}; }
+
+// Long enough to not fit into the inline buffer of std::string.
+template <>
+std::string make_key(uint32_t id) { return "hashmap_benchmark_key_" + std::to_string(id); }
+
+template <typename Map>
+struct MapTypes;
+
+template <template <typename...> typename Map, typename K, typename... Rest>
+struct MapTypes<Map<K, Rest...>>
+{
+    using Key = K;
+};
+
+template <typename Map>
+using map_key_t = typename MapTypes<Map>::Key;
+
+template <typename Map, typename Function>
+void measure_vectorized_operation(Map &openMap, Function func, const std::string &op_name, int invoke_vector_size, auto gen, auto dis, nlohmann::json &metrics)
 {
     openMap.profiler.reset();
     auto start = std::chrono::high_resolution_clock::now();
     auto end = std::chrono::high_resolution_clock::now();
     double total_time = 0;
 
-    std::vector<uint32_t> requests(invoke_vector_size);
+    std::vector<uint32_t> ids(invoke_vector_size);
+    std::vector<map_key_t<Map>> requests(invoke_vector_size);
     std::vector<uint32_t> results(invoke_vector_size);
     for (int i = 0; i < TOTAL_QUERIES; i += invoke_vector_size)
     {
         for (int j = 0; j < invoke_vector_size; j++)
         {
-            int random_number = dis(gen); // will generate duplicates, we don't care
-            requests.at(j) = random_number;
+            ids.at(j) = dis(gen); // will generate duplicates, we don't care
+            requests.at(j) = make_key<map_key_t<Map>>(ids.at(j));
         }
 
         start = std::chrono::high_resolution_clock::now();
@@ -40,7 +103,7 @@ void measure_vectorized_operation(HashMap<uint32_t, uint32_t> &openMap, Function
 
         for (int j = 0; j < invoke_vector_size; j++)
         {
-            assert(results.at(j) == requests.at(j) + 1);
+            assert(results.at(j) == ids.at(j) + 1);
         }
     }
 
@@ -55,9 +118,138 @@ void measure_vectorized_operation(HashMap<uint32_t, uint32_t> &openMap, Function
     metrics[op_name]["profiler"] = openMap.profiler.return_metrics();
 }
 
-nlohmann::json execute_benchmark(HashMap<uint32_t, uint32_t> &openMap, int GROUP_SIZE, int AMAC_REQUEST_SIZE, auto gen, auto dis)
+/*
+    Keys below num_keys are present in the map, a share of miss_ratio of the lookups asks for keys above that
+    range instead.
+*/
+template <typename Map, typename Function>
+void measure_find_operation(Map &openMap, Function func, const std::string &op_name, int invoke_vector_size, double miss_ratio, long num_keys, auto gen, auto dis, nlohmann::json &metrics)
+{
+    auto start = std::chrono::high_resolution_clock::now();
+    auto end = std::chrono::high_resolution_clock::now();
+    double total_time = 0;
+    size_t total_found = 0;
+
+    std::bernoulli_distribution miss_dis(miss_ratio);
+    std::vector<uint32_t> ids(invoke_vector_size);
+    std::vector<map_key_t<Map>> requests(invoke_vector_size);
+    std::vector<uint32_t> results(invoke_vector_size);
+    std::vector<bool> found(invoke_vector_size);
+    for (int i = 0; i < TOTAL_QUERIES; i += invoke_vector_size)
+    {
+        for (int j = 0; j < invoke_vector_size; j++)
+        {
+            uint32_t id = dis(gen);
+            ids.at(j) = miss_dis(gen) ? num_keys + id : id;
+            requests.at(j) = make_key<map_key_t<Map>>(ids.at(j));
+        }
+
+        start = std::chrono::high_resolution_clock::now();
+        total_found += func(requests, results, found, GROUP_SIZE);
+        end = std::chrono::high_resolution_clock::now();
+        total_time += std::chrono::duration<double>(end - start).count();
+
+        for (int j = 0; j < invoke_vector_size; j++)
+        {
+            assert(found.at(j) == (ids.at(j) < num_keys));
+            assert(!found.at(j) || results.at(j) == ids.at(j) + 1);
+        }
+    }
+
+    double throughput = TOTAL_QUERIES / total_time;
+
+    std::cout << std::endl;
+    std::cout << op_name << std::endl;
+    std::cout << "Total time taken: " << total_time << " seconds" << std::endl;
+    std::cout << "Throughput: " << throughput << " queries/second" << std::endl;
+    std::cout << "Hit ratio: " << static_cast<double>(total_found) / TOTAL_QUERIES << std::endl;
+    metrics[op_name]["time"] = total_time;
+    metrics[op_name]["throughput"] = throughput;
+    metrics[op_name]["hit_ratio"] = static_cast<double>(total_found) / TOTAL_QUERIES;
+}
+
+template <typename Map, typename Function>
+void measure_mixed_operation(Map &openMap, Function func, const std::string &op_name, int invoke_vector_size, auto gen, auto dis, nlohmann::json &metrics)
+{
+    auto start = std::chrono::high_resolution_clock::now();
+    auto end = std::chrono::high_resolution_clock::now();
+    double total_time = 0;
+
+    // Every pair of operations leaves the map unchanged, so the read benchmarks can still validate their results.
+    std::vector<Operation<map_key_t<Map>, uint32_t>> operations(invoke_vector_size);
+    for (int i = 0; i < TOTAL_QUERIES; i += invoke_vector_size)
+    {
+        for (int j = 0; j + 1 < invoke_vector_size; j += 2)
+        {
+            uint32_t id = dis(gen);
+            auto key = make_key<map_key_t<Map>>(id);
+            if (j % 4 == 0)
+            {
+                operations.at(j) = {OperationType::Remove, key, 0};
+                operations.at(j + 1) = {OperationType::Insert, key, id + 1};
+            }
+            else
+            {
+                operations.at(j) = {OperationType::Upsert, key, id + 1};
+                operations.at(j + 1) = {OperationType::Insert, key, id + 2};
+            }
+        }
+
+        start = std::chrono::high_resolution_clock::now();
+        func(operations, GROUP_SIZE);
+        end = std::chrono::high_resolution_clock::now();
+        total_time += std::chrono::duration<double>(end - start).count();
+    }
+
+    double throughput = TOTAL_QUERIES / total_time;
+
+    std::cout << std::endl;
+    std::cout << op_name << std::endl;
+    std::cout << "Total time taken: " << total_time << " seconds" << std::endl;
+    std::cout << "Throughput: " << throughput << " operations/second" << std::endl;
+    metrics[op_name]["time"] = total_time;
+    metrics[op_name]["throughput"] = throughput;
+}
+
+template <typename Map>
+void execute_find_benchmark(Map &openMap, double miss_ratio, long num_keys, auto gen, auto dis, nlohmann::json &results)
+{
+    measure_find_operation(
+        openMap, [&](auto &a, auto &b, auto &f, auto &c)
+        { return openMap.vectorized_find_amac(a, b, f, c); },
+        "Vectorized_find_amac()", AMAC_REQUESTS_SIZE, miss_ratio, num_keys, gen, dis, results);
+    measure_find_operation(
+        openMap, [&](auto &a, auto &b, auto &f, auto &c)
+        { return openMap.vectorized_find_coroutine(a, b, f, c); },
+        "Vectorized_find_co()", AMAC_REQUESTS_SIZE, miss_ratio, num_keys, gen, dis, results);
+    measure_find_operation(
+        openMap, [&](auto &a, auto &b, auto &f, auto &c)
+        { return openMap.vectorized_find_gp(a, b, f); },
+        "Vectorized_find_gp()", GROUP_SIZE, miss_ratio, num_keys, gen, dis, results);
+    measure_find_operation(
+        openMap, [&](auto &a, auto &b, auto &f, auto &c)
+        { return openMap.vectorized_find(a, b, f); },
+        "Vectorized_find()", GROUP_SIZE, miss_ratio, num_keys, gen, dis, results);
+    measure_find_operation(
+        openMap, [&](auto &a, auto &b, auto &f, auto &c)
+        { return openMap.vectorized_find_coroutine_exp(a, b, f, c); },
+        "vectorized_find_coroutine_exp()", AMAC_REQUESTS_SIZE, miss_ratio, num_keys, gen, dis, results);
+}
+
+template <typename Map>
+nlohmann::json execute_benchmark(Map &openMap, int GROUP_SIZE, int AMAC_REQUEST_SIZE, double miss_ratio, long num_keys, size_t reorder_batch_size, auto gen, auto dis)
 {
     nlohmann::json results;
+    if constexpr (requires(std::vector<map_key_t<Map>> &a, std::vector<uint32_t> &b, std::vector<bool> &f, int c) { openMap.vectorized_find_amac(a, b, f, c); })
+    {
+        execute_find_benchmark(openMap, miss_ratio, num_keys, gen, dis, results);
+    }
+    if (miss_ratio > 0)
+    {
+        // The get variants throw on the first missing key, only the find variants can be measured with misses.
+        return results;
+    }
+
     measure_vectorized_operation(
         openMap, [&](auto &a, auto &b, auto &c)
         { openMap.vectorized_get_amac(a, b, c); },
@@ -78,13 +270,292 @@ nlohmann::json execute_benchmark(HashMap<uint32_t, uint32_t> &openMap, int GROUP
         openMap, [&](auto &a, auto &b, auto &c)
         { openMap.vectorized_get_coroutine_exp(a, b, c); },
         "vectorized_get_coroutine_exp()", AMAC_REQUESTS_SIZE, gen, dis, results);
-    measure_vectorized_operation(
-        openMap, [&](auto &a, auto &b, auto &c)
-        { openMap.profile_vectorized_get_coroutine_exp(a, b, c); },
-        "profile_vectorized_get_coroutine_exp()", AMAC_REQUESTS_SIZE, gen, dis, results);
+    if constexpr (requires(map_key_t<Map> &key) { openMap.address_of(key); })
+    {
+        AdaptiveDispatcher<Map, map_key_t<Map>, uint32_t> dispatcher{openMap, static_cast<size_t>(GROUP_SIZE)};
+        measure_vectorized_operation(
+            openMap, [&](auto &a, auto &b, auto &c)
+            { dispatcher.vectorized_get(a, b); },
+            "Vectorized_get_adaptive()", AMAC_REQUESTS_SIZE, gen, dis, results);
+        results["Vectorized_get_adaptive()"]["technique"] = technique_name(dispatcher.config().technique);
+        results["Vectorized_get_adaptive()"]["group_size"] = dispatcher.config().group_size;
+        results["Vectorized_get_adaptive()"]["miss_rate"] = dispatcher.miss_rate();
+        results["Vectorized_get_adaptive()"]["explorations"] = dispatcher.explorations();
+
+        // Page ordered batches against the same batch size issued in request order.
+        measure_vectorized_operation(
+            openMap, [&](auto &a, auto &b, auto &c)
+            { openMap.vectorized_get_coroutine(a, b, c); },
+            "Vectorized_get_co_unordered()", static_cast<int>(reorder_batch_size), gen, dis, results);
+        for (size_t page_size : {size_t{4096}, HUGE_PAGE_SIZE})
+        {
+            PageReorder<Map, map_key_t<Map>, uint32_t> reorder{openMap, page_size, 0};
+            std::string op_name = "Vectorized_get_co_reordered_" + std::to_string(page_size / 1024) + "K()";
+            measure_vectorized_operation(
+                openMap, [&](auto &a, auto &b, auto &c)
+                { reorder.vectorized_get(a, b, Technique::Coroutine, c); },
+                op_name, static_cast<int>(reorder_batch_size), gen, dis, results);
+        }
+    }
+    if constexpr (requires(std::vector<map_key_t<Map>> &a, std::vector<uint32_t> &b, int c) { openMap.profile_vectorized_get_coroutine_exp(a, b, c); })
+    {
+        measure_vectorized_operation(
+            openMap, [&](auto &a, auto &b, auto &c)
+            { openMap.profile_vectorized_get_coroutine_exp(a, b, c); },
+            "profile_vectorized_get_coroutine_exp()", AMAC_REQUESTS_SIZE, gen, dis, results);
+    }
+    if constexpr (requires(std::vector<Operation<map_key_t<Map>, uint32_t>> &a, int c) { openMap.vectorized_mixed_amac(a, c); })
+    {
+        measure_mixed_operation(
+            openMap, [&](auto &a, auto &c)
+            { openMap.vectorized_mixed_amac(a, c); },
+            "Vectorized_mixed_amac()", AMAC_REQUESTS_SIZE, gen, dis, results);
+        measure_mixed_operation(
+            openMap, [&](auto &a, auto &c)
+            { openMap.vectorized_mixed_coroutine(a, c); },
+            "Vectorized_mixed_co()", AMAC_REQUESTS_SIZE, gen, dis, results);
+    }
     return results;
 };
 
+/*
+    All lookup threads run the same technique at the same time while one writer thread keeps rewriting the
+    looked up keys (with their unchanged value) and inserts/removes keys outside of the looked up range.
+*/
+template <typename Map>
+nlohmann::json execute_concurrent_benchmark(Map &openMap, size_t num_threads, long num_keys, auto dis)
+{
+    using Function = std::function<void(std::vector<uint32_t> &, std::vector<uint32_t> &, int)>;
+    std::vector<std::tuple<std::string, Function, int>> operations = {
+        {"Vectorized_get_amac()", [&](auto &a, auto &b, auto c)
+         { openMap.vectorized_get_amac(a, b, c); }, AMAC_REQUESTS_SIZE},
+        {"Vectorized_get_co()", [&](auto &a, auto &b, auto c)
+         { openMap.vectorized_get_coroutine(a, b, c); }, AMAC_REQUESTS_SIZE},
+        {"Vectorized_get_gp()", [&](auto &a, auto &b, auto c)
+         { openMap.vectorized_get_gp(a, b); }, GROUP_SIZE},
+        {"Vectorized_get()", [&](auto &a, auto &b, auto c)
+         { openMap.vectorized_get(a, b); }, GROUP_SIZE},
+        {"vectorized_get_coroutine_exp()", [&](auto &a, auto &b, auto c)
+         { openMap.vectorized_get_coroutine_exp(a, b, c); }, AMAC_REQUESTS_SIZE}};
+
+    auto &manager = Prefetching::get().numa_manager;
+    std::vector<NodeID> cpus;
+    for (auto node : manager.active_nodes)
+    {
+        cpus.insert(cpus.end(), manager.node_to_available_cpus[node].begin(), manager.node_to_available_cpus[node].end());
+    }
+
+    nlohmann::json metrics;
+    for (auto &[op_name, func, invoke_vector_size] : operations)
+    {
+        std::atomic<bool> stop_writer{false};
+        std::atomic<size_t> writer_operations{0};
+        std::jthread writer([&]()
+                            {
+                                pin_to_cpu(cpus[num_threads % cpus.size()]);
+                                std::mt19937 gen(42);
+                                std::uniform_int_distribution<uint32_t> update_dis(0, num_keys - 1);
+                                size_t operations = 0;
+                                while (!stop_writer)
+                                {
+                                    uint32_t key = update_dis(gen);
+                                    openMap.insert(key, key + 1);
+                                    uint32_t extra_key = num_keys + update_dis(gen);
+                                    if (openMap.contains(extra_key))
+                                    {
+                                        openMap.remove(extra_key);
+                                    }
+                                    else
+                                    {
+                                        openMap.insert(extra_key, extra_key + 1);
+                                    }
+                                    operations += 2;
+                                }
+                                writer_operations = operations; });
+
+        auto start = std::chrono::high_resolution_clock::now();
+        {
+            std::vector<std::jthread> readers;
+            for (size_t t = 0; t < num_threads; ++t)
+            {
+                readers.emplace_back([&, t]()
+                                     {
+                                         pin_to_cpu(cpus[t % cpus.size()]);
+                                         std::mt19937 gen(t);
+                                         auto thread_dis = dis;
+                                         std::vector<uint32_t> requests(invoke_vector_size);
+                                         std::vector<uint32_t> results(invoke_vector_size);
+                                         for (size_t i = 0; i < TOTAL_QUERIES / num_threads; i += invoke_vector_size)
+                                         {
+                                             for (int j = 0; j < invoke_vector_size; j++)
+                                             {
+                                                 requests.at(j) = thread_dis(gen);
+                                             }
+                                             func(requests, results, GROUP_SIZE);
+                                             for (int j = 0; j < invoke_vector_size; j++)
+                                             {
+                                                 assert(results.at(j) == requests.at(j) + 1);
+                                             }
+                                         } });
+            }
+        }
+        auto end = std::chrono::high_resolution_clock::now();
+        stop_writer = true;
+        writer.join();
+
+        double total_time = std::chrono::duration<double>(end - start).count();
+        double throughput = TOTAL_QUERIES / total_time;
+        std::cout << std::endl;
+        std::cout << op_name << " (" << num_threads << " threads)" << std::endl;
+        std::cout << "Total time taken: " << total_time << " seconds" << std::endl;
+        std::cout << "Throughput: " << throughput << " queries/second" << std::endl;
+        std::cout << "Concurrent writes: " << writer_operations << std::endl;
+        metrics[op_name]["time"] = total_time;
+        metrics[op_name]["throughput"] = throughput;
+        metrics[op_name]["threads"] = num_threads;
+        metrics[op_name]["writer_operations"] = writer_operations.load();
+    }
+    return metrics;
+}
+
+template <typename Map>
+nlohmann::json execute_benchmark_for(Map &openMap, ConfigMap &runtime_config, long num_keys, auto gen, auto dis)
+{
+    if constexpr (std::is_same_v<Map, ConcurrentHashMap<uint32_t, uint32_t>>)
+    {
+        return execute_concurrent_benchmark(openMap, convert<size_t>(runtime_config["threads"]), num_keys, dis);
+    }
+    else
+    {
+        return execute_benchmark(openMap, GROUP_SIZE, AMAC_REQUESTS_SIZE, convert<double>(runtime_config["miss_ratio"]), num_keys, convert<size_t>(runtime_config["reorder_batch_size"]), gen, dis);
+    }
+}
+
+template <typename Map>
+nlohmann::json run_benchmark(Map &openMap, ConfigMap &runtime_config, long num_keys)
+{
+    nlohmann::json results;
+    std::random_device rd;
+    std::mt19937 gen(rd());
+
+    std::uniform_int_distribution<> uniform_dis(0, num_keys - 1);
+
+    zipfian_int_distribution<int>::param_type p(0, num_keys - 1, 0.99, 27.000);
+    zipfian_int_distribution<int> zipfian_distribution(p);
+
+    auto start = std::chrono::high_resolution_clock::now();
+    if constexpr (requires(std::vector<map_key_t<Map>> &a, std::vector<uint32_t> &b, int c) { openMap.vectorized_insert_amac(a, b, c); })
+    {
+        std::vector<map_key_t<Map>> keys;
+        std::vector<uint32_t> values;
+        for (uint32_t offset = 0; offset < num_keys; offset += AMAC_REQUESTS_SIZE)
+        {
+            keys.clear();
+            values.clear();
+            for (uint32_t i = offset; i < std::min<long>(offset + AMAC_REQUESTS_SIZE, num_keys); i++)
+            {
+                keys.push_back(make_key<map_key_t<Map>>(i));
+                values.push_back(i + 1);
+            }
+            openMap.vectorized_insert_amac(keys, values, GROUP_SIZE);
+        }
+    }
+    else
+    {
+        for (uint32_t i = 0; i < num_keys; i++)
+        {
+            openMap.insert(make_key<map_key_t<Map>>(i), i + 1);
+        }
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    std::cout << "Populating took: " << std::chrono::duration<double>(end - start).count() << " seconds" << std::endl;
+    results["populate_time"] = std::chrono::duration<double>(end - start).count();
+
+    if constexpr (requires { openMap.compact(); })
+    {
+        if (convert<bool>(runtime_config["compact"]))
+        {
+            start = std::chrono::high_resolution_clock::now();
+            openMap.compact();
+            end = std::chrono::high_resolution_clock::now();
+            std::cout << "Compacting took: " << std::chrono::duration<double>(end - start).count() << " seconds" << std::endl;
+            results["compact_time"] = std::chrono::duration<double>(end - start).count();
+        }
+    }
+
+    if (runtime_config["distribution"] == "uniform")
+    {
+        std::cout << "----- Measuring Uniform Accesses -----" << std::endl;
+        results["uniform"] = execute_benchmark_for(openMap, runtime_config, num_keys, gen, uniform_dis);
+    }
+    else if (runtime_config["distribution"] == "zipfian")
+    {
+        std::cout << "----- Measuring Zipfian Accesses -----" << std::endl;
+        results["zipfian"] = execute_benchmark_for(openMap, runtime_config, num_keys, gen, zipfian_distribution);
+    }
+    else
+    {
+        std::cout << "Unknown Distribution Defined: " << runtime_config["distribution"] << std::endl;
+    }
+    return results;
+}
+
+template <typename K, typename Hash, typename Index>
+nlohmann::json run_chained_benchmark(ConfigMap &runtime_config, long num_keys, PrefetchProfiler &profiler, std::pmr::memory_resource &mem_res)
+{
+    using Map = HashMap<K, uint32_t, Hash, Index>;
+    // Declared before the map, the nodes have to be freed before their slabs.
+    SlabMemoryResource slab_res{Map::NODE_SIZE, mem_res};
+    auto &node_res = runtime_config["node_allocator"] == "slab" ? static_cast<std::pmr::memory_resource &>(slab_res) : mem_res;
+    Map openMap{convert<size_t>(runtime_config["number_buckets"]), profiler, node_res, convert<double>(runtime_config["max_load_factor"])};
+    auto results = run_benchmark(openMap, runtime_config, num_keys);
+    results["node_allocator"] = runtime_config["node_allocator"];
+    results["compact"] = convert<bool>(runtime_config["compact"]);
+    results["max_load_factor"] = runtime_config["max_load_factor"];
+    results["final_buckets"] = openMap.bucket_count();
+    results["hash"] = runtime_config["hash"];
+    results["index"] = runtime_config["index"];
+    return results;
+}
+
+template <typename K, typename Hash>
+nlohmann::json run_chained_benchmark(ConfigMap &runtime_config, long num_keys, PrefetchProfiler &profiler, std::pmr::memory_resource &mem_res)
+{
+    if (runtime_config["index"] == "modulo")
+    {
+        return run_chained_benchmark<K, Hash, ModuloIndex>(runtime_config, num_keys, profiler, mem_res);
+    }
+    else if (runtime_config["index"] == "mask")
+    {
+        return run_chained_benchmark<K, Hash, MaskIndex>(runtime_config, num_keys, profiler, mem_res);
+    }
+    std::cout << "Unknown Index Defined: " << runtime_config["index"] << std::endl;
+    return {};
+}
+
+template <typename K>
+nlohmann::json run_chained_benchmark(ConfigMap &runtime_config, long num_keys, PrefetchProfiler &profiler, std::pmr::memory_resource &mem_res)
+{
+    if (runtime_config["hash"] == "std")
+    {
+        return run_chained_benchmark<K, StdHash>(runtime_config, num_keys, profiler, mem_res);
+    }
+    else if (runtime_config["hash"] == "murmur")
+    {
+        return run_chained_benchmark<K, MurmurHash>(runtime_config, num_keys, profiler, mem_res);
+    }
+    else if (runtime_config["hash"] == "crc32")
+    {
+        return run_chained_benchmark<K, Crc32Hash>(runtime_config, num_keys, profiler, mem_res);
+    }
+    else if (runtime_config["hash"] == "multiply_shift")
+    {
+        return run_chained_benchmark<K, MultiplyShiftHash>(runtime_config, num_keys, profiler, mem_res);
+    }
+    std::cout << "Unknown Hash Defined: " << runtime_config["hash"] << std::endl;
+    return {};
+}
+
 int main(int argc, char **argv)
 {
     auto &manager = Prefetching::get().numa_manager;
@@ -92,8 +563,19 @@ int main(int argc, char **argv)
     // clang-format off
     benchmark_config.add_options()
         ("d,distribution", "Type of distribution", cxxopts::value<std::vector<std::string>>()->default_value("uniform,zipfian"))
+        ("m,map", "Hash map layout (chained, compact, bucketed, swiss, cuckoo, concurrent, sharded)", cxxopts::value<std::vector<std::string>>()->default_value("chained,bucketed,swiss,cuckoo"))
+        ("t,threads", "Number of lookup threads running next to one writer thread (concurrent map), or lookup workers per NUMA node (sharded map)", cxxopts::value<std::vector<size_t>>()->default_value("1"))
         ("number_keys", "Number of keys to fill the hashmap with", cxxopts::value<std::vector<long>>()->default_value("10000000"))
-        ("number_buckets", "Number of buckets in the hashmap", cxxopts::value<std::vector<size_t>>()->default_value("500000"));
+        ("number_buckets", "Number of buckets in the hashmap", cxxopts::value<std::vector<size_t>>()->default_value("500000"))
+        ("k,key_type", "Key type (4B, 8B, 16B, string), all but 4B are only supported by the chained map", cxxopts::value<std::vector<std::string>>()->default_value("4B"))
+        ("hash", "Hash policy of the chained hashmap (std, murmur, crc32, multiply_shift)", cxxopts::value<std::vector<std::string>>()->default_value("std"))
+        ("index", "Bucket index policy of the chained hashmap (modulo, mask), mask rounds number_buckets up to a power of two", cxxopts::value<std::vector<std::string>>()->default_value("modulo"))
+        ("miss_ratio", "Share of lookups asking for absent keys, measured with the non-throwing find variants", cxxopts::value<std::vector<double>>()->default_value("0"))
+        ("max_load_factor", "Load factor at which the chained hashmap doubles its buckets, 0 keeps number_buckets fixed", cxxopts::value<std::vector<double>>()->default_value("1.0"))
+        ("node_allocator", "Allocator of the chained hashmap's nodes (default, slab)", cxxopts::value<std::vector<std::string>>()->default_value("default"))
+        ("compact", "Re-cluster the chains of the chained hashmap after populating it", cxxopts::value<std::vector<bool>>()->default_value("false"))
+        ("reorder_batch_size", "Batch size of the page reordered lookups of the chained hashmap and their unordered baseline", cxxopts::value<std::vector<size_t>>()->default_value("65536"))
+        ("frame_pool", "Recycle coroutine frames through the per-thread frame pool instead of operator new", cxxopts::value<std::vector<bool>>()->default_value("true"));
     // clang-format on
     benchmark_config.parse(argc, argv);
 
@@ -101,39 +583,82 @@ int main(int argc, char **argv)
     for (auto &runtime_config : benchmark_config.get_runtime_configs())
     {
         auto num_keys = convert<long>(runtime_config["number_keys"]);
+        FramePool::enabled = convert<bool>(runtime_config["frame_pool"]);
 
         PrefetchProfiler profiler{30};
         StaticNumaMemoryResource mem_res{0};
-        HashMap<uint32_t, uint32_t> openMap{convert<size_t>(runtime_config["number_buckets"]), profiler, mem_res};
 
         nlohmann::json results;
-        std::random_device rd;
-        std::mt19937 gen(rd());
-
-        std::uniform_int_distribution<> uniform_dis(0, num_keys - 1);
-
-        zipfian_int_distribution<int>::param_type p(0, num_keys - 1, 0.99, 27.000);
-        zipfian_int_distribution<int> zipfian_distribution(p);
-
-        for (uint32_t i = 0; i < num_keys; i++)
+        if (runtime_config["map"] != "chained" && runtime_config["key_type"] != "4B")
         {
-            openMap.insert(i, i + 1);
+            std::cout << "Key type " << runtime_config["key_type"] << " is only supported by the chained map" << std::endl;
         }
-
-        if (runtime_config["distribution"] == "uniform")
+        else if (runtime_config["map"] == "chained")
+        {
+            if (runtime_config["key_type"] == "4B")
+            {
+                results = run_chained_benchmark<uint32_t>(runtime_config, num_keys, profiler, mem_res);
+            }
+            else if (runtime_config["key_type"] == "8B")
+            {
+                results = run_chained_benchmark<uint64_t>(runtime_config, num_keys, profiler, mem_res);
+            }
+            else if (runtime_config["key_type"] == "16B")
+            {
+                results = run_chained_benchmark<PairKey>(runtime_config, num_keys, profiler, mem_res);
+            }
+            else if (runtime_config["key_type"] == "string")
+            {
+                results = run_chained_benchmark<std::string>(runtime_config, num_keys, profiler, mem_res);
+            }
+            else
+            {
+                std::cout << "Unknown Key Type Defined: " << runtime_config["key_type"] << std::endl;
+            }
+        }
+        else if (runtime_config["map"] == "compact")
+        {
+            CompactHashMap<uint32_t, uint32_t> openMap{convert<size_t>(runtime_config["number_buckets"]), profiler, mem_res};
+            results = run_benchmark(openMap, runtime_config, num_keys);
+            results["memory_usage"] = openMap.memory_usage();
+        }
+        else if (runtime_config["map"] == "bucketed")
+        {
+            // Open addressing cannot hold more keys than slots, size the table by the number of keys instead.
+            BucketedHashMap<uint32_t, uint32_t> openMap{BucketedHashMap<uint32_t, uint32_t>::buckets_for(num_keys), profiler, mem_res};
+            results = run_benchmark(openMap, runtime_config, num_keys);
+        }
+        else if (runtime_config["map"] == "swiss")
+        {
+            SwissHashMap<uint32_t, uint32_t> openMap{SwissHashMap<uint32_t, uint32_t>::slots_for(num_keys), profiler, mem_res};
+            results = run_benchmark(openMap, runtime_config, num_keys);
+        }
+        else if (runtime_config["map"] == "cuckoo")
+        {
+            CuckooHashMap<uint32_t, uint32_t> openMap{CuckooHashMap<uint32_t, uint32_t>::buckets_for(num_keys), profiler, mem_res};
+            results = run_benchmark(openMap, runtime_config, num_keys);
+        }
+        else if (runtime_config["map"] == "concurrent")
         {
-            std::cout << "----- Measuring Uniform Accesses -----" << std::endl;
-            results["uniform"] = execute_benchmark(openMap, GROUP_SIZE, AMAC_REQUESTS_SIZE, gen, uniform_dis);
+            ConcurrentHashMap<uint32_t, uint32_t> openMap{convert<size_t>(runtime_config["number_buckets"]), profiler, mem_res};
+            results = run_benchmark(openMap, runtime_config, num_keys);
+            results["threads"] = runtime_config["threads"];
         }
-        else if (runtime_config["distribution"] == "zipfian")
+        else if (runtime_config["map"] == "sharded")
         {
-            std::cout << "----- Measuring Zipfian Accesses -----" << std::endl;
-            results["zipfian"] = execute_benchmark(openMap, GROUP_SIZE, AMAC_REQUESTS_SIZE, gen, zipfian_distribution);
+            ShardedHashMap<uint32_t, uint32_t> openMap{convert<size_t>(runtime_config["number_buckets"]), profiler, convert<size_t>(runtime_config["threads"])};
+            results = run_benchmark(openMap, runtime_config, num_keys);
+            results["threads"] = runtime_config["threads"];
+            results["shards"] = openMap.num_shards();
         }
         else
         {
-            std::cout << "Unknown Distribution Defined: " << runtime_config["distribution"] << std::endl;
+            std::cout << "Unknown Map Defined: " << runtime_config["map"] << std::endl;
         }
+        results["map"] = runtime_config["map"];
+        results["miss_ratio"] = runtime_config["miss_ratio"];
+        results["key_type"] = runtime_config["key_type"];
+        results["frame_pool"] = runtime_config["frame_pool"];
 
         auto results_file = std::ofstream{"hashmap_benchmark_" + std::to_string(benchmark_run++) + ".json"};
         results_file << results.dump(-1) << std::flush;
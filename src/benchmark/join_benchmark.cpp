@@ -0,0 +1,125 @@
+#include "hash_join.hpp"
+#include "prefetching.hpp"
+
+#include <random>
+#include <algorithm>
+#include <numeric>
+#include <chrono>
+#include <nlohmann/json.hpp>
+#include <fstream>
+
+#include "zipfian_int_distribution.cpp"
+#include "numa/static_numa_memory_resource.hpp"
+
+// Build keys are unique, probe keys hit one of them with probability match_rate and miss all of them otherwise.
+template <typename Distribution>
+size_t generate_probe_keys(std::vector<uint32_t> &probe_keys, size_t build_size, double match_rate, std::mt19937 &gen, Distribution dis)
+{
+    std::bernoulli_distribution match_dis(match_rate);
+    size_t expected_matches = 0;
+    for (auto &key : probe_keys)
+    {
+        uint32_t id = dis(gen);
+        if (match_dis(gen))
+        {
+            key = id;
+            expected_matches++;
+        }
+        else
+        {
+            key = build_size + id;
+        }
+    }
+    return expected_matches;
+}
+
+int main(int argc, char **argv)
+{
+    auto &benchmark_config = Prefetching::get().runtime_config;
+    // clang-format off
+    benchmark_config.add_options()
+        ("build_size", "Number of rows of the build relation", cxxopts::value<std::vector<size_t>>()->default_value("1000000"))
+        ("probe_size", "Number of rows of the probe relation", cxxopts::value<std::vector<size_t>>()->default_value("25000000"))
+        ("match_rate", "Share of probe rows that find a join partner", cxxopts::value<std::vector<double>>()->default_value("1.0"))
+        ("d,distribution", "Distribution of the probe keys over the build keys (uniform, zipfian)", cxxopts::value<std::vector<std::string>>()->default_value("uniform,zipfian"))
+        ("skew", "Skew (theta) of the zipfian distribution", cxxopts::value<std::vector<double>>()->default_value("0.99"))
+        ("technique", "Probe technique (plain, gp, amac, coroutine, coroutine_exp)", cxxopts::value<std::vector<std::string>>()->default_value("plain,gp,amac,coroutine,coroutine_exp"))
+        ("group_size", "Number of interleaved lookups, GP probes batches of this size", cxxopts::value<std::vector<int>>()->default_value("32"))
+        ("batch_size", "Number of probe keys handed to the interleaved lookups at once", cxxopts::value<std::vector<size_t>>()->default_value("1024"));
+    // clang-format on
+    benchmark_config.parse(argc, argv);
+
+    int benchmark_run = 0;
+    for (auto &runtime_config : benchmark_config.get_runtime_configs())
+    {
+        auto build_size = convert<size_t>(runtime_config["build_size"]);
+        auto probe_size = convert<size_t>(runtime_config["probe_size"]);
+        auto match_rate = convert<double>(runtime_config["match_rate"]);
+        auto technique = parse_technique(runtime_config["technique"]);
+        auto group_size = convert<int>(runtime_config["group_size"]);
+        auto batch_size = convert<size_t>(runtime_config["batch_size"]);
+
+        std::random_device rd;
+        std::mt19937 gen(rd());
+
+        std::vector<uint32_t> build_keys(build_size);
+        std::iota(build_keys.begin(), build_keys.end(), 0);
+        std::shuffle(build_keys.begin(), build_keys.end(), gen);
+
+        std::vector<uint32_t> probe_keys(probe_size);
+        size_t expected_matches;
+        if (runtime_config["distribution"] == "uniform")
+        {
+            expected_matches = generate_probe_keys(probe_keys, build_size, match_rate, gen, std::uniform_int_distribution<uint32_t>(0, build_size - 1));
+        }
+        else if (runtime_config["distribution"] == "zipfian")
+        {
+            zipfian_int_distribution<int> zipfian_distribution(0, build_size - 1, convert<double>(runtime_config["skew"]));
+            expected_matches = generate_probe_keys(probe_keys, build_size, match_rate, gen, zipfian_distribution);
+        }
+        else
+        {
+            std::cout << "Unknown Distribution Defined: " << runtime_config["distribution"] << std::endl;
+            continue;
+        }
+
+        PrefetchProfiler profiler{30};
+        StaticNumaMemoryResource mem_res{0};
+        HashJoin<uint32_t> join{profiler, mem_res};
+
+        auto start = std::chrono::high_resolution_clock::now();
+        join.build(build_keys);
+        auto end = std::chrono::high_resolution_clock::now();
+        double build_time = std::chrono::duration<double>(end - start).count();
+
+        start = std::chrono::high_resolution_clock::now();
+        auto result = join.probe(probe_keys, technique, group_size, batch_size);
+        end = std::chrono::high_resolution_clock::now();
+        double probe_time = std::chrono::duration<double>(end - start).count();
+
+        if (result.size() != expected_matches)
+        {
+            std::cout << "Join produced " << result.size() << " matches, expected " << expected_matches << std::endl;
+        }
+
+        std::cout << std::endl;
+        std::cout << runtime_config["technique"] << " " << runtime_config["distribution"] << std::endl;
+        std::cout << "Build time: " << build_time << " seconds" << std::endl;
+        std::cout << "Probe time: " << probe_time << " seconds" << std::endl;
+        std::cout << "Probe throughput: " << probe_size / probe_time << " rows/second" << std::endl;
+        std::cout << "Matches: " << result.size() << std::endl;
+
+        nlohmann::json results;
+        results["config"] = runtime_config;
+        results["build_time"] = build_time;
+        results["probe_time"] = probe_time;
+        results["probe_throughput"] = probe_size / probe_time;
+        results["matches"] = result.size();
+        results["expected_matches"] = expected_matches;
+
+        auto results_file = std::ofstream{"join_benchmark_" + std::to_string(benchmark_run++) + ".json"};
+        results_file << results.dump(-1) << std::flush;
+    }
+
+    return 0;
+}
@@ -1,96 +1,368 @@
 #include "random_access.hpp"
+#include "adaptive_dispatcher.hpp"
+#include "page_reorder.hpp"
+#include "executor.hpp"
+#include "prefetching.hpp"
+#include "numa/static_numa_memory_resource.hpp"
+#include "numa/interleaving_numa_memory_resource.hpp"
 
 #include <random>
 #include <functional>
 #include <chrono>
 #include <assert.h>
+#include <thread>
+#include <memory>
+#include <fstream>
+#include <algorithm>
+#include <stdexcept>
+#include <nlohmann/json.hpp>
 #include "zipfian_int_distribution.cpp"
 #include <iostream>
 
-const int NUM_VALUES = 6'000'000; // ~ roughly 24MB seems to be the sweet-spot for low tlb misses, high cache misses
-const int TOTAL_QUERIES = 25'000'000;
+const int TOTAL_QUERIES = 25'000'000; // per thread
 const int GROUP_SIZE = 32;
 const int AMAC_REQUESTS_SIZE = 1024;
 
-template <typename Function>
-void measure_vectorized_operation(RandomAccess<uint8_t> &random_access, Function func, const std::string &op_name, int invoke_vector_size, auto gen, auto dis)
+// Every thread pinned to cpus[t] runs TOTAL_QUERIES lookups through func(requests, results, GROUP_SIZE, t).
+// Write operations find the values to store in results, they are not verified. The writes are plain read-modify-
+// writes, so every thread writes its own slice of the drawn positions (position t * slice + drawn % slice).
+template <typename V, typename Function>
+void measure_vectorized_operation(RandomAccess<V> &random_access, Function func, const std::string &op_name, int invoke_vector_size, const std::vector<NodeID> &cpus, auto dis, nlohmann::json &metrics, bool writes = false)
 {
-    auto start = std::chrono::high_resolution_clock::now();
-    auto end = std::chrono::high_resolution_clock::now();
-    double total_time = 0;
-
-    std::vector<size_t> requests(invoke_vector_size);
-    std::vector<uint8_t> results(invoke_vector_size);
-    for (int i = 0; i < TOTAL_QUERIES; i += invoke_vector_size)
+    std::vector<double> times(cpus.size());
+    size_t slice = (static_cast<size_t>(dis.max()) + 1) / cpus.size();
+    if (writes && slice == 0)
+    {
+        throw std::invalid_argument("Write benchmarks require at least one position per thread.");
+    }
     {
-        for (int j = 0; j < invoke_vector_size; j++)
+        std::vector<std::jthread> threads;
+        for (size_t t = 0; t < cpus.size(); ++t)
         {
-            int random_number = dis(gen); // will generate duplicates, we don't care
-            requests.at(j) = random_number;
-        }
+            threads.emplace_back([&, t, dis]() mutable
+                                 {
+                pin_to_cpu(cpus[t]);
+                std::random_device rd;
+                std::mt19937 gen(rd());
 
-        start = std::chrono::high_resolution_clock::now();
-        func(requests, results, GROUP_SIZE);
-        end = std::chrono::high_resolution_clock::now();
-        total_time += std::chrono::duration<double>(end - start).count();
+                auto start = std::chrono::high_resolution_clock::now();
+                auto end = std::chrono::high_resolution_clock::now();
+                double total_time = 0;
 
-        for (int j = 0; j < invoke_vector_size; j++)
-        {
-            if (!(results.at(j) == (requests.at(j) % 256)))
-            {
-                perror("random read returned wrong value.");
-                exit(-1);
-            }
+                std::vector<size_t> requests(invoke_vector_size);
+                std::vector<V> results(invoke_vector_size);
+                for (int i = 0; i < TOTAL_QUERIES; i += invoke_vector_size)
+                {
+                    for (int j = 0; j < invoke_vector_size; j++)
+                    {
+                        size_t random_number = dis(gen); // will generate duplicates, we don't care
+                        if (writes)
+                        {
+                            random_number = t * slice + random_number % slice;
+                            results.at(j) = static_cast<V>(random_number);
+                        }
+                        requests.at(j) = random_number;
+                    }
+
+                    start = std::chrono::high_resolution_clock::now();
+                    func(requests, results, GROUP_SIZE, t);
+                    end = std::chrono::high_resolution_clock::now();
+                    total_time += std::chrono::duration<double>(end - start).count();
+
+                    for (int j = 0; j < invoke_vector_size && !writes; j++)
+                    {
+                        if (!(results.at(j) == static_cast<V>(requests.at(j))))
+                        {
+                            perror("random read returned wrong value.");
+                            exit(-1);
+                        }
+                    }
+                }
+                times[t] = total_time; });
         }
     }
 
-    double throughput = TOTAL_QUERIES / total_time;
+    // The slowest thread determines the time of the whole run.
+    double total_time = *std::max_element(times.begin(), times.end());
+    double throughput = static_cast<double>(TOTAL_QUERIES) * cpus.size() / total_time;
 
     std::cout << std::endl;
     std::cout << op_name << std::endl;
     std::cout << "Total time taken: " << total_time << " seconds" << std::endl;
     std::cout << "Throughput: " << throughput << " queries/second" << std::endl;
+    metrics[op_name]["time"] = total_time;
+    metrics[op_name]["throughput"] = throughput;
 }
 
-void execute_benchmark(RandomAccess<uint8_t> &random_access, int GROUP_SIZE, int AMAC_REQUEST_SIZE, auto gen, auto dis)
+template <typename V>
+void execute_benchmark(RandomAccess<V> &random_access, const std::vector<NodeID> &cpus, auto dis, size_t reorder_batch_size, size_t executor_batch_size, nlohmann::json &results)
 {
     measure_vectorized_operation(
-        random_access, [&](auto &a, auto &b, auto &c)
+        random_access, [&](auto &a, auto &b, auto &c, auto)
         { random_access.vectorized_get_amac(a, b, c); },
-        "Vectorized_get_amac()", AMAC_REQUESTS_SIZE, gen, dis);
+        "Vectorized_get_amac()", AMAC_REQUESTS_SIZE, cpus, dis, results);
     measure_vectorized_operation(
-        random_access, [&](auto &a, auto &b, auto &c)
+        random_access, [&](auto &a, auto &b, auto &c, auto)
         { random_access.vectorized_get_coroutine(a, b, c); },
-        "Vectorized_get_co()", AMAC_REQUESTS_SIZE, gen, dis);
+        "Vectorized_get_co()", AMAC_REQUESTS_SIZE, cpus, dis, results);
     measure_vectorized_operation(
-        random_access, [&](auto &a, auto &b, auto &c)
+        random_access, [&](auto &a, auto &b, auto &c, auto)
         { random_access.vectorized_get_gp(a, b); },
-        "Vectorized_get_gp()", GROUP_SIZE, gen, dis);
+        "Vectorized_get_gp()", GROUP_SIZE, cpus, dis, results);
     measure_vectorized_operation(
-        random_access, [&](auto &a, auto &b, auto &c)
+        random_access, [&](auto &a, auto &b, auto &c, auto)
         { random_access.vectorized_get(a, b); },
-        "Vectorized_get()", GROUP_SIZE, gen, dis);
+        "Vectorized_get()", GROUP_SIZE, cpus, dis, results);
     measure_vectorized_operation(
-        random_access, [&](auto &a, auto &b, auto &c)
+        random_access, [&](auto &a, auto &b, auto &c, auto)
         { random_access.vectorized_get_coroutine_exp(a, b, c); },
-        "vectorized_get_coroutine_exp()", AMAC_REQUESTS_SIZE, gen, dis);
+        "vectorized_get_coroutine_exp()", AMAC_REQUESTS_SIZE, cpus, dis, results);
+    measure_vectorized_operation(
+        random_access, [&](auto &a, auto &b, auto &c, auto)
+        { random_access.vectorized_get_pipelined(a, b); },
+        "Vectorized_get_pipelined()", AMAC_REQUESTS_SIZE, cpus, dis, results);
+    results["Vectorized_get_pipelined()"]["prefetch_distance"] = random_access.prefetch_distance();
+    measure_vectorized_operation(
+        random_access, [&](auto &a, auto &b, auto &c, auto)
+        { random_access.vectorized_get_gather(a, b); },
+        "Vectorized_get_gather()", AMAC_REQUESTS_SIZE, cpus, dis, results);
+    measure_vectorized_operation(
+        random_access, [&](auto &a, auto &b, auto &c, auto)
+        { random_access.vectorized_get_gather_prefetch(a, b, c); },
+        "Vectorized_get_gather_prefetch()", AMAC_REQUESTS_SIZE, cpus, dis, results);
+
+    // One dispatcher per thread, each adapts to what its own CPU observes.
+    std::vector<AdaptiveDispatcher<RandomAccess<V>, size_t, V>> dispatchers;
+    dispatchers.reserve(cpus.size());
+    for (size_t t = 0; t < cpus.size(); ++t)
+    {
+        dispatchers.emplace_back(random_access, GROUP_SIZE);
+    }
+    measure_vectorized_operation(
+        random_access, [&](auto &a, auto &b, auto &c, auto t)
+        { dispatchers[t].vectorized_get(a, b); },
+        "Vectorized_get_adaptive()", AMAC_REQUESTS_SIZE, cpus, dis, results);
+    auto &dispatcher = dispatchers.front();
+    std::cout << "Chosen: " << technique_name(dispatcher.config().technique) << ", group size " << dispatcher.config().group_size << ", miss rate " << dispatcher.miss_rate() << std::endl;
+    results["Vectorized_get_adaptive()"]["technique"] = technique_name(dispatcher.config().technique);
+    results["Vectorized_get_adaptive()"]["group_size"] = dispatcher.config().group_size;
+    results["Vectorized_get_adaptive()"]["miss_rate"] = dispatcher.miss_rate();
+
+    // Page ordered batches against the same batch size issued in request order.
+    measure_vectorized_operation(
+        random_access, [&](auto &a, auto &b, auto &c, auto)
+        { random_access.vectorized_get_coroutine(a, b, c); },
+        "Vectorized_get_co_unordered()", reorder_batch_size, cpus, dis, results);
+    for (size_t page_size : {size_t{4096}, HUGE_PAGE_SIZE})
+    {
+        std::vector<PageReorder<RandomAccess<V>, size_t, V>> reorders;
+        reorders.reserve(cpus.size());
+        for (size_t t = 0; t < cpus.size(); ++t)
+        {
+            reorders.emplace_back(random_access, page_size, 0);
+        }
+        std::string op_name = "Vectorized_get_co_reordered_" + std::to_string(page_size / 1024) + "K()";
+        measure_vectorized_operation(
+            random_access, [&](auto &a, auto &b, auto &c, auto t)
+            { reorders[t].vectorized_get(a, b, Technique::Coroutine, c); },
+            op_name, reorder_batch_size, cpus, dis, results);
+    }
+
+    // One thread issues large batches, the executor spreads every batch over a worker per CPU.
+    WorkStealingExecutor executor({Prefetching::get().numa_manager.cpu_to_node[cpus.front()]}, cpus.size());
+    measure_vectorized_operation(
+        random_access, [&](auto &a, auto &b, auto &c, auto)
+        { random_access.vectorized_get_coroutine(a, b, c, executor); },
+        "Vectorized_get_co_executor()", executor_batch_size, {cpus.front()}, dis, results);
+    results["Vectorized_get_co_executor()"]["workers"] = executor.num_workers();
+    results["Vectorized_get_co_executor()"]["stolen_chunks"] = executor.stolen_chunks();
 };
 
-int main()
+// Scattered stores (or increments) of the values the reads expect, so the read for ownership of every line is measured.
+template <typename V>
+void execute_write_benchmark(RandomAccess<V> &random_access, const std::vector<NodeID> &cpus, auto dis, bool increment, nlohmann::json &results)
+{
+    std::string prefix = increment ? "Vectorized_increment" : "Vectorized_put";
+    measure_vectorized_operation(
+        random_access, [&](auto &a, auto &b, auto &c, auto)
+        { increment ? random_access.vectorized_increment_amac(a, c) : random_access.vectorized_put_amac(a, b, c); },
+        prefix + "_amac()", AMAC_REQUESTS_SIZE, cpus, dis, results, true);
+    measure_vectorized_operation(
+        random_access, [&](auto &a, auto &b, auto &c, auto)
+        { increment ? random_access.vectorized_increment_coroutine(a, c) : random_access.vectorized_put_coroutine(a, b, c); },
+        prefix + "_co()", AMAC_REQUESTS_SIZE, cpus, dis, results, true);
+    measure_vectorized_operation(
+        random_access, [&](auto &a, auto &b, auto &c, auto)
+        { increment ? random_access.vectorized_increment_gp(a) : random_access.vectorized_put_gp(a, b); },
+        prefix + "_gp()", GROUP_SIZE, cpus, dis, results, true);
+    measure_vectorized_operation(
+        random_access, [&](auto &a, auto &b, auto &c, auto)
+        { increment ? random_access.vectorized_increment(a) : random_access.vectorized_put(a, b); },
+        prefix + "()", GROUP_SIZE, cpus, dis, results, true);
+    measure_vectorized_operation(
+        random_access, [&](auto &a, auto &b, auto &c, auto)
+        { increment ? random_access.vectorized_increment_coroutine_exp(a, c) : random_access.vectorized_put_coroutine_exp(a, b, c); },
+        prefix + "_coroutine_exp()", AMAC_REQUESTS_SIZE, cpus, dis, results, true);
+}
+
+template <typename V>
+bool run_benchmark(ConfigMap &runtime_config, std::pmr::memory_resource &mem_res, const std::vector<NodeID> &cpus, nlohmann::json &results)
+{
+    auto number_values = convert<size_t>(runtime_config["number_values"]);
+    auto &distribution = runtime_config["distribution"];
+    auto reorder_batch_size = convert<size_t>(runtime_config["reorder_batch_size"]);
+    auto executor_batch_size = convert<size_t>(runtime_config["executor_batch_size"]);
+    auto &mode = runtime_config["mode"];
+    RandomAccess<V> random_access{number_values, mem_res};
+    if (auto prefetch_distance = convert<size_t>(runtime_config["prefetch_distance"]))
+    {
+        random_access.set_prefetch_distance(prefetch_distance);
+    }
+    if (distribution == "uniform")
+    {
+        std::cout << "----- Measuring Uniform Accesses -----" << std::endl;
+        auto dis = std::uniform_int_distribution<>(0, number_values - 1);
+        if (mode == "read")
+        {
+            execute_benchmark(random_access, cpus, dis, reorder_batch_size, executor_batch_size, results);
+        }
+        else
+        {
+            execute_write_benchmark(random_access, cpus, dis, mode == "rmw", results);
+        }
+    }
+    else if (distribution == "zipfian")
+    {
+        zipfian_int_distribution<int>::param_type p(1, std::min<size_t>(1e6, number_values - 1), 0.99, 27.000);
+        std::cout << "----- Measuring Zipfian Accesses -----" << std::endl;
+        auto dis = zipfian_int_distribution<int>(p);
+        if (mode == "read")
+        {
+            execute_benchmark(random_access, cpus, dis, reorder_batch_size, executor_batch_size, results);
+        }
+        else
+        {
+            execute_write_benchmark(random_access, cpus, dis, mode == "rmw", results);
+        }
+    }
+    else
+    {
+        return false;
+    }
+    return true;
+}
+
+int main(int argc, char **argv)
 {
-    RandomAccess<uint8_t> random_access{size_t{NUM_VALUES}};
+    auto &manager = Prefetching::get().numa_manager;
+    auto &benchmark_config = Prefetching::get().runtime_config;
+    // clang-format off
+    benchmark_config.add_options()
+        ("number_values", "Number of values, ~24MB seems to be the sweet-spot for low tlb misses, high cache misses", cxxopts::value<std::vector<size_t>>()->default_value("60000,6000000,600000000"))
+        ("value_size", "Size of the values in bytes (1, 2, 4, 8)", cxxopts::value<std::vector<size_t>>()->default_value("1"))
+        ("reorder_batch_size", "Batch size of the page reordered lookups and their unordered baseline", cxxopts::value<std::vector<size_t>>()->default_value("65536"))
+        ("executor_batch_size", "Batch size of the lookups spread over all threads by the work stealing executor", cxxopts::value<std::vector<size_t>>()->default_value("1048576"))
+        ("frame_pool", "Recycle coroutine frames through the per-thread frame pool instead of operator new", cxxopts::value<std::vector<bool>>()->default_value("true,false"))
+        ("prefetch_distance", "Distance of the pipelined lookups, 0 keeps the calibrated one", cxxopts::value<std::vector<size_t>>()->default_value("0"))
+        ("d,distribution", "Type of distribution (uniform, zipfian)", cxxopts::value<std::vector<std::string>>()->default_value("uniform,zipfian"))
+        ("mode", "Operation of the batches (read, write, rmw), rmw increments the values", cxxopts::value<std::vector<std::string>>()->default_value("read"))
+        ("placement", "Placement of the array relative to the threads (local, remote, interleaved)", cxxopts::value<std::vector<std::string>>()->default_value("local"))
+        ("page_size", "Pages backing the array (small, transparent, explicit), explicit requires reserved huge pages", cxxopts::value<std::vector<std::string>>()->default_value("small"))
+        ("t,threads", "Number of threads, each pinned to its own CPU of the first active NUMA node, 0 uses all of them", cxxopts::value<std::vector<size_t>>()->default_value("1"));
+    // clang-format on
+    benchmark_config.parse(argc, argv);
 
-    std::random_device rd;
-    std::mt19937 gen(rd());
-    std::uniform_int_distribution<> uniform_dis(0, NUM_VALUES - 1);
+    int benchmark_run = 0;
+    for (auto &runtime_config : benchmark_config.get_runtime_configs())
+    {
+        auto threads = convert<size_t>(runtime_config["threads"]);
+        FramePool::enabled = convert<bool>(runtime_config["frame_pool"]);
+        auto &placement = runtime_config["placement"];
+        auto &page_size = runtime_config["page_size"];
 
-    zipfian_int_distribution<int>::param_type p(1, 1e6, 0.99, 27.000);
-    zipfian_int_distribution<int> zipfian_distribution(p);
+        NodeID home_node = manager.active_nodes.front();
+        auto &node_cpus = manager.node_to_available_cpus[home_node];
+        if (threads == 0 || threads > node_cpus.size())
+        {
+            threads = node_cpus.size();
+        }
+        std::vector<NodeID> cpus(node_cpus.begin(), node_cpus.begin() + threads);
 
-    std::cout << "----- Measuring Uniform Accesses -----" << std::endl;
-    execute_benchmark(random_access, GROUP_SIZE, AMAC_REQUESTS_SIZE, gen, uniform_dis);
-    std::cout << "----- Measuring Zipfian Accesses -----" << std::endl;
-    execute_benchmark(random_access, GROUP_SIZE, AMAC_REQUESTS_SIZE, gen, zipfian_distribution);
+        if (runtime_config["mode"] != "read" && runtime_config["mode"] != "write" && runtime_config["mode"] != "rmw")
+        {
+            std::cout << "Unknown Mode Defined: " << runtime_config["mode"] << std::endl;
+            continue;
+        }
+        if (page_size != "small" && page_size != "transparent" && page_size != "explicit")
+        {
+            std::cout << "Unknown Page Size Defined: " << page_size << std::endl;
+            continue;
+        }
+        bool use_explicit_huge_pages = page_size == "explicit";
+        bool madvise_huge_pages = page_size == "transparent";
+
+        std::unique_ptr<std::pmr::memory_resource> mem_res;
+        if (placement == "local")
+        {
+            mem_res = std::make_unique<StaticNumaMemoryResource>(home_node, use_explicit_huge_pages, madvise_huge_pages);
+        }
+        else if (placement == "remote")
+        {
+            // Node ids need not be contiguous, the remote node is the next active one.
+            if (manager.active_nodes.size() < 2)
+            {
+                std::cout << "Remote placement requires a second active NUMA node, only node " << home_node << " is active" << std::endl;
+                continue;
+            }
+            mem_res = std::make_unique<StaticNumaMemoryResource>(manager.active_nodes[1], use_explicit_huge_pages, madvise_huge_pages);
+        }
+        else if (placement == "interleaved")
+        {
+            mem_res = std::make_unique<InterleavingNumaMemoryResource>(manager.number_nodes, use_explicit_huge_pages, madvise_huge_pages);
+        }
+        else
+        {
+            std::cout << "Unknown Placement Defined: " << placement << std::endl;
+            continue;
+        }
+
+        std::cout << "----- " << placement << " placement, " << page_size << " pages, " << cpus.size() << " threads -----" << std::endl;
+        nlohmann::json results;
+        auto value_size = convert<size_t>(runtime_config["value_size"]);
+        bool known_distribution = true;
+        if (value_size == 1)
+        {
+            known_distribution = run_benchmark<uint8_t>(runtime_config, *mem_res, cpus, results);
+        }
+        else if (value_size == 2)
+        {
+            known_distribution = run_benchmark<uint16_t>(runtime_config, *mem_res, cpus, results);
+        }
+        else if (value_size == 4)
+        {
+            known_distribution = run_benchmark<uint32_t>(runtime_config, *mem_res, cpus, results);
+        }
+        else if (value_size == 8)
+        {
+            known_distribution = run_benchmark<uint64_t>(runtime_config, *mem_res, cpus, results);
+        }
+        else
+        {
+            std::cout << "Unknown Value Size Defined: " << value_size << std::endl;
+            continue;
+        }
+        if (!known_distribution)
+        {
+            std::cout << "Unknown Distribution Defined: " << runtime_config["distribution"] << std::endl;
+            continue;
+        }
+        results["gather_instruction_set"] = gather_instruction_set();
+        results["config"] = runtime_config;
+        results["threads"] = cpus.size();
+
+        auto results_file = std::ofstream{"random_read_benchmark_" + std::to_string(benchmark_run++) + ".json"};
+        results_file << results.dump(-1) << std::flush;
+    }
 
     return 0;
-}
\ No newline at end of file
+}
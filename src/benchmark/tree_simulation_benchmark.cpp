@@ -16,6 +16,7 @@
 #include "numa/interleaving_numa_memory_resource.hpp"
 #include "utils/utils.cpp"
 #include "coroutine.hpp"
+#include "prefetch.hpp"
 
 enum CoSlotState : uint8_t
 {
@@ -36,7 +37,7 @@ enum CoSlotState : uint8_t
 struct thread_frame // TODO: align this struct to Cache line
 {
     std::atomic<CoSlotState> *running_coroutines = nullptr;
-    std::atomic<task *> *coroutines = nullptr;
+    std::atomic<task<> *> *coroutines = nullptr;
     thread_frame(size_t number_of_coroutines)
     {
         running_coroutines = new std::atomic<CoSlotState>[number_of_coroutines];
@@ -44,7 +45,7 @@ struct thread_frame // TODO: align this struct to Cache line
         {
             running_coroutines[i] = Empty;
         }
-        coroutines = new std::atomic<task *>[number_of_coroutines];
+        coroutines = new std::atomic<task<> *>[number_of_coroutines];
     }
     ~thread_frame()
     {
@@ -125,15 +126,14 @@ find_in_node(uint32_t *node, uint32_t k, uint32_t values_per_node)
     return values_per_node;
 }
 
-task co_find_in_node(uint32_t *node, uint32_t k, uint32_t values_per_node, uint32_t &found_value)
+task<unsigned> co_find_in_node(uint32_t *node, uint32_t k, uint32_t values_per_node)
 {
     unsigned lower = 0;
     unsigned upper = values_per_node;
     do
     {
         unsigned mid = ((upper - lower) / 2) + lower;
-        __builtin_prefetch(reinterpret_cast<void *>(node + mid), 0, 3);
-        co_await std::suspend_always{};
+        co_await prefetch(node + mid);
         if (k < node[mid])
         {
             upper = mid;
@@ -144,30 +144,25 @@ task co_find_in_node(uint32_t *node, uint32_t k, uint32_t values_per_node, uint3
         }
         else
         {
-            found_value = mid;
-            co_return;
+            co_return mid;
         }
     } while (lower < upper);
     throw std::runtime_error("could not find value in node " + std::to_string(k));
-    co_return;
 }
 
-task co_tree_traversal(TreeSimulationConfig &config, char *data, uint32_t k, uint32_t values_per_node,
-                       std::uniform_int_distribution<> node_distribution, auto gen)
+task<> co_tree_traversal(TreeSimulationConfig &config, char *data, uint32_t k, uint32_t values_per_node,
+                         std::uniform_int_distribution<> node_distribution, auto gen)
 {
     int sum = 0;
     for (int j = 0; j < config.num_node_traversal_per_lookup; j++)
     {
         auto next_node = node_distribution(gen);
-        uint32_t found;
-        co_find_in_node(reinterpret_cast<uint32_t *>(data + (next_node * config.tree_node_size)), k, values_per_node, found);
-        sum += found;
+        sum += co_await co_find_in_node(reinterpret_cast<uint32_t *>(data + (next_node * config.tree_node_size)), k, values_per_node);
     }
     if (sum != config.num_node_traversal_per_lookup * k)
     {
-        "lookups failed " + std::to_string(sum) + " vs. " + std::to_string(config.num_node_traversal_per_lookup * k);
+        throw std::runtime_error("lookups failed " + std::to_string(sum) + " vs. " + std::to_string(config.num_node_traversal_per_lookup * k));
     }
-    co_return;
 }
 
 auto jump_to_other_node(size_t curr_node_id, size_t target_node_id, size_t starting_node)
@@ -178,9 +173,9 @@ auto jump_to_other_node(size_t curr_node_id, size_t target_node_id, size_t start
         size_t target_node_id;
         size_t starting_node;
         bool await_ready() { return false; }
-        void await_suspend(task h)
+        void await_suspend(std::coroutine_handle<task<>::promise_type> h)
         {
-            h.next_node = target_node_id;
+            h.promise().root->next_node = target_node_id;
         }
         void await_resume() {}
     };
@@ -212,8 +207,8 @@ auto handle_exit(size_t curr_node_id, size_t starting_node)
     return awaitable{curr_node_id, starting_node};
 }
 
-task co_tree_traversal_jumping(TreeSimulationConfig &config, char *data, uint32_t k, uint32_t values_per_node,
-                               std::uniform_int_distribution<> node_distribution, auto gen)
+task<> co_tree_traversal_jumping(TreeSimulationConfig &config, char *data, uint32_t k, uint32_t values_per_node,
+                                 std::uniform_int_distribution<> node_distribution, auto gen)
 {
     auto starting_node = SCHEDULER_THREAD_INFO.curr_group_node_id;
 
@@ -230,15 +225,12 @@ task co_tree_traversal_jumping(TreeSimulationConfig &config, char *data, uint32_
             co_await jump_to_other_node(curr_node_id, target_node, starting_node);
         }
         // handling complete
-        uint32_t found;
-        co_find_in_node(reinterpret_cast<uint32_t *>(data + (next_node * config.tree_node_size)), k, values_per_node, found);
-        sum += found;
+        sum += co_await co_find_in_node(reinterpret_cast<uint32_t *>(data + (next_node * config.tree_node_size)), k, values_per_node);
     }
     if (sum != config.num_node_traversal_per_lookup * k)
     {
-        "lookups failed " + std::to_string(sum) + " vs. " + std::to_string(config.num_node_traversal_per_lookup * k);
+        throw std::runtime_error("lookups failed " + std::to_string(sum) + " vs. " + std::to_string(config.num_node_traversal_per_lookup * k));
     }
-    co_return;
 }
 
 void scheduler_thread_function(NodeID cpu, std::vector<std::atomic<thread_frame *>> &thread_frames, char *data, size_t group_thread_id, size_t values_per_node,
@@ -280,27 +272,28 @@ void scheduler_thread_function(NodeID cpu, std::vector<std::atomic<thread_frame
                         continue;
                     }
                     auto k = uniform_dis_node_value(gen);
-                    tf->coroutines[i] = new task(co_tree_traversal(config, data, k, values_per_node,
-                                                                   uniform_dis_next_node, gen));
-                    tf->coroutines[i].load()->next_node = group_thread_id;
+                    tf->coroutines[i] = new task<>(co_tree_traversal(config, data, k, values_per_node,
+                                                                     uniform_dis_next_node, gen));
+                    tf->coroutines[i].load()->next_node() = group_thread_id;
                     num_scheduled++;
                     tf->running_coroutines[i] = Resumable;
                 }
                 break;
                 case Resumable:
-                    if (!tf->coroutines[i].load()->coro.done())
+                    if (!tf->coroutines[i].load()->done())
                     {
-                        tf->coroutines[i].load()->coro.resume();
-                        if (tf->coroutines[i].load()->next_node != group_thread_id)
+                        tf->coroutines[i].load()->resume();
+                        if (tf->coroutines[i].load()->next_node() != group_thread_id)
                         {
                             tf->running_coroutines[i] = Remote;
-                            thread_frames[tf->coroutines[i].load()->next_node].load()->coroutines[i] = tf->coroutines[i].load();
+                            thread_frames[tf->coroutines[i].load()->next_node()].load()->coroutines[i] = tf->coroutines[i].load();
                             sfence();
-                            thread_frames[tf->coroutines[i].load()->next_node].load()->running_coroutines[i] = Resumable;
+                            thread_frames[tf->coroutines[i].load()->next_node()].load()->running_coroutines[i] = Resumable;
                         }
                     }
                     else
                     {
+                        tf->coroutines[i].load()->result();
                         delete tf->coroutines[i];
                         tf->coroutines[i] = nullptr;
                         tf->running_coroutines[i] = Finished;
@@ -328,15 +321,15 @@ void scheduler_thread_function(NodeID cpu, std::vector<std::atomic<thread_frame
                 switch (tf->running_coroutines[i])
                 {
                 case Resumable:
-                    if (!tf->coroutines[i].load()->coro.done())
+                    if (!tf->coroutines[i].load()->done())
                     {
-                        tf->coroutines[i].load()->coro.resume();
-                        if (tf->coroutines[i].load()->next_node != group_thread_id)
+                        tf->coroutines[i].load()->resume();
+                        if (tf->coroutines[i].load()->next_node() != group_thread_id)
                         {
                             tf->running_coroutines[i] = Empty;
-                            thread_frames[tf->coroutines[i].load()->next_node].load()->coroutines[i] = tf->coroutines[i].load();
+                            thread_frames[tf->coroutines[i].load()->next_node()].load()->coroutines[i] = tf->coroutines[i].load();
                             sfence();
-                            thread_frames[tf->coroutines[i].load()->next_node].load()->running_coroutines[i] = Resumable;
+                            thread_frames[tf->coroutines[i].load()->next_node()].load()->running_coroutines[i] = Resumable;
                         }
                     }
                     else
@@ -403,8 +396,8 @@ void scheduler_thread_function_jumping(NodeID cpu, std::vector<std::atomic<threa
                         continue;
                     }
                     auto k = uniform_dis_node_value(gen);
-                    tf->coroutines[i] = new task(co_tree_traversal_jumping(config, data, k, values_per_node,
-                                                                           uniform_dis_next_node, gen));
+                    tf->coroutines[i] = new task<>(co_tree_traversal_jumping(config, data, k, values_per_node,
+                                                                             uniform_dis_next_node, gen));
                     num_scheduled++;
                     tf->running_coroutines[i] = Resumable;
                 }
@@ -433,12 +426,13 @@ void scheduler_thread_function_jumping(NodeID cpu, std::vector<std::atomic<threa
                     }
                 };
 
-                    if (!tf->coroutines[i].load()->coro.done())
+                    if (!tf->coroutines[i].load()->done())
                     {
-                        tf->coroutines[i].load()->coro.resume();
+                        tf->coroutines[i].load()->resume();
                     }
                     else
                     {
+                        tf->coroutines[i].load()->result();
                         delete tf->coroutines[i];
                         tf->coroutines[i] = nullptr;
                         tf->running_coroutines[i] = Finished;
@@ -466,9 +460,9 @@ void scheduler_thread_function_jumping(NodeID cpu, std::vector<std::atomic<threa
                 switch (tf->running_coroutines[i])
                 {
                 case Resumable:
-                    if (!tf->coroutines[i].load()->coro.done())
+                    if (!tf->coroutines[i].load()->done())
                     {
-                        tf->coroutines[i].load()->coro.resume();
+                        tf->coroutines[i].load()->resume();
                     }
                     else
                     {
@@ -541,16 +535,22 @@ void tree_simulation_coroutine(TreeSimulationConfig config, size_t repetitions,
     std::mt19937 gen(rd());
     std::uniform_int_distribution<> uniform_dis_node_value(0, values_per_node - 1);
     std::uniform_int_distribution<> uniform_dis_next_node(0, num_tree_nodes - 1);
-    CircularBuffer<task> buff(config.coroutines);
+    CircularBuffer<task<>> buff(config.coroutines);
 
     size_t num_finished = 0;
     int num_scheduled = 0;
 
     while (num_finished < repetitions)
     {
-        task &handle = buff.next_state();
-        if (handle.empty || handle.coro.done())
+        task<> &handle = buff.next_state();
+        if (!handle || handle.done())
         {
+            if (handle)
+            {
+                handle.result();
+                handle = task<>{};
+                num_finished++;
+            }
             if (num_scheduled < repetitions)
             {
                 auto k = uniform_dis_node_value(gen);
@@ -558,14 +558,10 @@ void tree_simulation_coroutine(TreeSimulationConfig config, size_t repetitions,
                                            uniform_dis_next_node, gen);
                 num_scheduled++;
             }
-            if (num_scheduled > config.coroutines)
-            {
-                num_finished++;
-            }
             continue;
         }
 
-        handle.coro.resume();
+        handle.resume();
     }
 }
 
@@ -0,0 +1,251 @@
+#pragma once
+
+#include <vector>
+#include <chrono>
+#include <algorithm>
+#include <iterator>
+
+#include "technique.hpp"
+#include "utils/utils.cpp"
+
+/*
+    Picks the technique and group size for the batched lookups of a structure (HashMap, RandomAccess) at runtime.
+
+    Every batch samples a few of its lookups with is_in_tlb_and_prefetch. As long as the smoothed miss rate stays
+    below cached_miss_rate the working set is considered cache resident and the batches run plain, interleaving
+    would only add overhead. Otherwise the dispatcher measures the throughput of trial_batches batches per
+    candidate: first every technique at the current group size, then it hill-climbs the group size of the best
+    technique by doubling (or halving) it as long as the throughput improves. The winner runs until the miss rate
+    changes its regime, its throughput drops or reexplore_interval batches passed, then the search restarts.
+*/
+template <typename Structure, typename Key, typename Value>
+class AdaptiveDispatcher
+{
+public:
+    struct Config
+    {
+        Technique technique;
+        size_t group_size;
+    };
+
+    AdaptiveDispatcher(Structure &structure, size_t initial_group_size = 32, size_t trial_batches = 4, size_t reexplore_interval = 1024, double cached_miss_rate = 0.1);
+    void vectorized_get(const std::vector<Key> &keys, std::vector<Value> &results);
+    Config config() const;
+    double miss_rate() const;
+    size_t explorations() const;
+
+private:
+    enum class Phase
+    {
+        Technique,
+        GroupSize,
+        Stable
+    };
+
+    static constexpr Technique CANDIDATES[] = {Technique::Plain, Technique::GP, Technique::AMAC, Technique::Coroutine, Technique::CoroutineExp};
+    static constexpr size_t SAMPLES_PER_BATCH = 8;
+    static constexpr size_t MAX_GROUP_SIZE = 512;
+    static constexpr double MIN_IMPROVEMENT = 0.03;
+    static constexpr double MAX_DROP = 0.2;
+    static constexpr double MISS_RATE_SMOOTHING = 0.1;
+
+    Structure &structure;
+    size_t trial_batches;
+    size_t reexplore_interval;
+    double cached_miss_rate;
+
+    Phase phase = Phase::Technique;
+    Config current;
+    Config best;
+    double best_throughput = 0;
+    size_t candidate = 0;
+    int direction = 1;
+    bool moved = false;
+    bool cached = false;
+    double smoothed_miss_rate = -1;
+    size_t stable_batches = 0;
+    size_t num_explorations = 0;
+
+    size_t trial_keys = 0;
+    double trial_time = 0;
+    size_t trial_count = 0;
+
+    TechniqueBuffers<Key, Value> buffers;
+
+    double sample_miss_rate(const std::vector<Key> &keys);
+    void run(const Config &config, const std::vector<Key> &keys, std::vector<Value> &results);
+    void explore();
+    bool climb(int towards);
+    void next_candidate(double throughput);
+};
+
+template <typename Structure, typename Key, typename Value>
+AdaptiveDispatcher<Structure, Key, Value>::AdaptiveDispatcher(Structure &structure, size_t initial_group_size, size_t trial_batches, size_t reexplore_interval, double cached_miss_rate)
+    : structure(structure), trial_batches(std::max<size_t>(trial_batches, 1)), reexplore_interval(reexplore_interval), cached_miss_rate(cached_miss_rate), current{Technique::Plain, std::clamp<size_t>(initial_group_size, 1, MAX_GROUP_SIZE)}, best(current)
+{
+    explore();
+}
+
+template <typename Structure, typename Key, typename Value>
+double AdaptiveDispatcher<Structure, Key, Value>::sample_miss_rate(const std::vector<Key> &keys)
+{
+    size_t samples = std::min(SAMPLES_PER_BATCH, keys.size());
+    size_t misses = 0;
+    for (size_t s = 0; s < samples; ++s)
+    {
+        misses += !is_in_tlb_and_prefetch(structure.address_of(keys[s * keys.size() / samples]));
+    }
+    return static_cast<double>(misses) / samples;
+}
+
+template <typename Structure, typename Key, typename Value>
+void AdaptiveDispatcher<Structure, Key, Value>::run(const Config &config, const std::vector<Key> &keys, std::vector<Value> &results)
+{
+    run_technique(structure, config.technique, keys, results, config.group_size, buffers);
+}
+
+template <typename Structure, typename Key, typename Value>
+void AdaptiveDispatcher<Structure, Key, Value>::explore()
+{
+    phase = Phase::Technique;
+    candidate = 0;
+    best = {CANDIDATES[0], best.group_size};
+    best_throughput = 0;
+    current = best;
+    stable_batches = 0;
+    trial_keys = 0;
+    trial_time = 0;
+    trial_count = 0;
+    num_explorations++;
+}
+
+// Moves current one step away from best, returns false if the group size would leave its bounds.
+template <typename Structure, typename Key, typename Value>
+bool AdaptiveDispatcher<Structure, Key, Value>::climb(int towards)
+{
+    direction = towards;
+    size_t group_size = towards > 0 ? best.group_size * 2 : best.group_size / 2;
+    if (group_size < 1 || group_size > MAX_GROUP_SIZE)
+    {
+        return false;
+    }
+    current = {best.technique, group_size};
+    return true;
+}
+
+template <typename Structure, typename Key, typename Value>
+void AdaptiveDispatcher<Structure, Key, Value>::next_candidate(double throughput)
+{
+    if (phase == Phase::Technique)
+    {
+        if (throughput > best_throughput)
+        {
+            best = current;
+            best_throughput = throughput;
+        }
+        if (++candidate < std::size(CANDIDATES))
+        {
+            current = {CANDIDATES[candidate], best.group_size};
+            return;
+        }
+        // The group size does not matter for plain lookups.
+        phase = Phase::GroupSize;
+        moved = false;
+        if (best.technique == Technique::Plain || !(climb(1) || climb(-1)))
+        {
+            phase = Phase::Stable;
+            current = best;
+        }
+    }
+    else if (phase == Phase::GroupSize)
+    {
+        if (throughput > best_throughput * (1 + MIN_IMPROVEMENT))
+        {
+            best = current;
+            best_throughput = throughput;
+            moved = true;
+            if (climb(direction))
+            {
+                return;
+            }
+        }
+        else if (direction > 0 && !moved && climb(-1))
+        {
+            return;
+        }
+        phase = Phase::Stable;
+        current = best;
+    }
+    else
+    {
+        if (throughput < best_throughput * (1 - MAX_DROP))
+        {
+            explore();
+            return;
+        }
+        best_throughput = std::max(best_throughput, throughput);
+    }
+}
+
+template <typename Structure, typename Key, typename Value>
+void AdaptiveDispatcher<Structure, Key, Value>::vectorized_get(const std::vector<Key> &keys, std::vector<Value> &results)
+{
+    if (keys.empty())
+    {
+        return;
+    }
+
+    double batch_miss_rate = sample_miss_rate(keys);
+    smoothed_miss_rate = smoothed_miss_rate < 0 ? batch_miss_rate : (1 - MISS_RATE_SMOOTHING) * smoothed_miss_rate + MISS_RATE_SMOOTHING * batch_miss_rate;
+    bool now_cached = smoothed_miss_rate < cached_miss_rate;
+    if (now_cached != cached)
+    {
+        cached = now_cached;
+        explore();
+    }
+    if (cached)
+    {
+        run({Technique::Plain, best.group_size}, keys, results);
+        return;
+    }
+
+    if (phase == Phase::Stable && ++stable_batches >= reexplore_interval)
+    {
+        stable_batches = 0;
+        explore();
+    }
+
+    auto start = std::chrono::high_resolution_clock::now();
+    run(current, keys, results);
+    auto end = std::chrono::high_resolution_clock::now();
+
+    trial_keys += keys.size();
+    trial_time += std::chrono::duration<double>(end - start).count();
+    if (++trial_count < trial_batches)
+    {
+        return;
+    }
+    double throughput = trial_keys / trial_time;
+    trial_keys = 0;
+    trial_time = 0;
+    trial_count = 0;
+    next_candidate(throughput);
+}
+
+template <typename Structure, typename Key, typename Value>
+typename AdaptiveDispatcher<Structure, Key, Value>::Config AdaptiveDispatcher<Structure, Key, Value>::config() const
+{
+    return cached ? Config{Technique::Plain, best.group_size} : current;
+}
+
+template <typename Structure, typename Key, typename Value>
+double AdaptiveDispatcher<Structure, Key, Value>::miss_rate() const
+{
+    return std::max(smoothed_miss_rate, 0.0);
+}
+
+template <typename Structure, typename Key, typename Value>
+size_t AdaptiveDispatcher<Structure, Key, Value>::explorations() const
+{
+    return num_explorations;
+}
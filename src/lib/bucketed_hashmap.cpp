@@ -0,0 +1,387 @@
+#include <cmath>
+#include <stdexcept>
+
+#include "bucketed_hashmap.hpp"
+#include "utils.cpp"
+#include "interleave.hpp"
+
+template <typename K, typename V>
+inline int find_slot(const Bucket<K, V> &bucket, const K &key)
+{
+    for (int slot = 0; slot < bucket.count; ++slot)
+    {
+        if (bucket.keys[slot] == key)
+        {
+            return slot;
+        }
+    }
+    return -1;
+}
+
+template <typename K, typename V>
+size_t BucketedHashMap<K, V>::hash(const K &key)
+{
+    return std::hash<K>{}(key) % capacity;
+}
+
+template <typename K, typename V>
+size_t BucketedHashMap<K, V>::next_bucket(size_t index)
+{
+    return index + 1 == capacity ? 0 : index + 1;
+}
+
+template <typename K, typename V>
+BucketedHashMap<K, V>::BucketedHashMap(size_t capacity, PrefetchProfiler &profiler, std::pmr::memory_resource &memory_resource) : capacity(capacity), size(0), profiler(profiler), memory_resource(memory_resource), table(&memory_resource)
+{
+    if (capacity == 0)
+    {
+        throw std::invalid_argument("BucketedHashMap requires at least one bucket.");
+    }
+    table.resize(capacity);
+}
+
+template <typename K, typename V>
+BucketedHashMap<K, V>::~BucketedHashMap() {}
+
+template <typename K, typename V>
+size_t BucketedHashMap<K, V>::buckets_for(size_t num_keys, double fill_factor)
+{
+    return std::max(size_t{1}, static_cast<size_t>(std::ceil(num_keys / (Bucket<K, V>::SLOTS * fill_factor))));
+}
+
+template <typename K, typename V>
+void BucketedHashMap<K, V>::insert(const K &key, const V &value)
+{
+    size_t index = hash(key);
+    size_t insert_index = capacity;
+    for (size_t probes = 0; probes < capacity; ++probes)
+    {
+        auto &bucket = table[index];
+        int slot = find_slot(bucket, key);
+        if (slot >= 0)
+        {
+            bucket.values[slot] = value;
+            return;
+        }
+        if (insert_index == capacity && bucket.count < Bucket<K, V>::SLOTS)
+        {
+            insert_index = index;
+        }
+        if (!bucket.overflowed)
+        {
+            break;
+        }
+        index = next_bucket(index);
+    }
+
+    if (insert_index == capacity)
+    {
+        // Every bucket of the probe sequence is full, extend it to the next bucket with a free slot.
+        index = hash(key);
+        for (size_t probes = 0; probes < capacity; ++probes)
+        {
+            if (table[index].count < Bucket<K, V>::SLOTS)
+            {
+                insert_index = index;
+                break;
+            }
+            table[index].overflowed = true;
+            index = next_bucket(index);
+        }
+        if (insert_index == capacity)
+        {
+            throw std::length_error("BucketedHashMap is full");
+        }
+    }
+
+    auto &bucket = table[insert_index];
+    bucket.keys[bucket.count] = key;
+    bucket.values[bucket.count] = value;
+    bucket.count++;
+    size++;
+}
+
+template <typename K, typename V>
+V &BucketedHashMap<K, V>::get(const K &key)
+{
+    size_t index = hash(key);
+    for (size_t probes = 0; probes < capacity; ++probes)
+    {
+        auto &bucket = table[index];
+        int slot = find_slot(bucket, key);
+        if (slot >= 0)
+        {
+            return bucket.values[slot];
+        }
+        if (!bucket.overflowed)
+        {
+            break;
+        }
+        index = next_bucket(index);
+    }
+    throw std::out_of_range("Key not found");
+}
+
+template <typename K, typename V>
+void BucketedHashMap<K, V>::vectorized_get(const std::vector<K> &keys, std::vector<V> &results)
+{
+    int i = 0;
+    for (auto &key : keys)
+    {
+        results.at(i) = get(key);
+        i++;
+    }
+}
+
+template <typename K, typename V>
+void BucketedHashMap<K, V>::vectorized_get_gp(const std::vector<K> &keys, std::vector<V> &results)
+{
+    // states:
+    //  0: Bucket prefetched, scan it
+    //  1: Finished, element found
+    std::vector<int> states(keys.size(), 0);
+    std::vector<size_t> indices(keys.size());
+    std::vector<size_t> probes(keys.size(), 0);
+
+    for (size_t i = 0; i < keys.size(); i++)
+    {
+        indices[i] = hash(keys[i]);
+        __builtin_prefetch(&table[indices[i]], 0, 3);
+    }
+
+    int finished = 0;
+    while (finished < keys.size())
+    {
+        for (int i = 0; i < keys.size(); i++)
+        {
+            if (states[i] == 1)
+            {
+                continue;
+            }
+            auto &bucket = table[indices[i]];
+            int slot = find_slot(bucket, keys[i]);
+            if (slot >= 0)
+            {
+                results[i] = bucket.values[slot];
+                states[i] = 1;
+                ++finished;
+                continue;
+            }
+            if (!bucket.overflowed || ++probes[i] == capacity)
+            {
+                throw std::out_of_range("Key not found.");
+            }
+            indices[i] = next_bucket(indices[i]);
+            __builtin_prefetch(&table[indices[i]], 0, 3);
+        }
+    }
+}
+
+template <typename K, typename V>
+void BucketedHashMap<K, V>::vectorized_get_amac(const std::vector<K> &keys, std::vector<V> &results, int group_size)
+{
+    CircularBuffer<AMAC_state> buff(group_size);
+
+    int num_finished = 0;
+    int i = 0;
+    while (num_finished < keys.size())
+    {
+        AMAC_state &state = buff.next_state();
+
+        if (state.stage == 0)
+        {
+            if (i >= keys.size())
+            {
+                continue;
+            }
+            state.i = i;
+            state.key = keys[i++];
+            state.index = hash(state.key);
+            state.probes = 0;
+            state.stage = 1;
+            __builtin_prefetch(&table[state.index], 0, 3);
+        }
+        else if (state.stage == 1)
+        {
+            auto &bucket = table[state.index];
+            int slot = find_slot(bucket, state.key);
+            if (slot >= 0)
+            {
+                state.stage = 0;
+                results[state.i] = bucket.values[slot];
+                num_finished++;
+            }
+            else
+            {
+                if (!bucket.overflowed || ++state.probes == capacity)
+                {
+                    throw std::out_of_range("Key not found.");
+                }
+                state.index = next_bucket(state.index);
+                __builtin_prefetch(&table[state.index], 0, 3);
+            }
+        }
+    }
+}
+
+template <typename K, typename V>
+coroutine BucketedHashMap<K, V>::get_co(const K &key, std::vector<V> &results, const int i)
+{
+    size_t index = hash(key);
+    for (size_t probes = 0; probes < capacity; ++probes)
+    {
+        __builtin_prefetch(&table[index], 0, 3);
+        co_await std::suspend_always{};
+
+        auto &bucket = table[index];
+        int slot = find_slot(bucket, key);
+        if (slot >= 0)
+        {
+            results.at(i) = bucket.values[slot];
+            co_return;
+        }
+        if (!bucket.overflowed)
+        {
+            break;
+        }
+        index = next_bucket(index);
+    }
+    throw std::out_of_range("Key not found");
+}
+
+template <typename K, typename V>
+coroutine BucketedHashMap<K, V>::get_co_exp(const K &key, std::vector<V> &results, const int i)
+{
+    size_t index = hash(key);
+    for (size_t probes = 0; probes < capacity; ++probes)
+    {
+        if (!is_in_tlb_and_prefetch(&table[index]))
+        {
+            co_await std::suspend_always{};
+        }
+
+        auto &bucket = table[index];
+        int slot = find_slot(bucket, key);
+        if (slot >= 0)
+        {
+            results.at(i) = bucket.values[slot];
+            co_return;
+        }
+        if (!bucket.overflowed)
+        {
+            break;
+        }
+        index = next_bucket(index);
+    }
+    throw std::out_of_range("Key not found");
+}
+
+template <typename K, typename V>
+coroutine BucketedHashMap<K, V>::profile_get_co_exp(const K &key, std::vector<V> &results, const int i)
+{
+    size_t prefetch_count = 0;
+    bool assume_cached = true;
+    size_t index = hash(key);
+    for (size_t probes = 0; probes < capacity; ++probes)
+    {
+        if (!is_in_tlb_prefetch_profile(&table[index], prefetch_count, profiler, assume_cached))
+        {
+            co_await std::suspend_always{};
+        }
+
+        auto &bucket = table[index];
+        int slot = find_slot(bucket, key);
+        if (slot >= 0)
+        {
+            results.at(i) = bucket.values[slot];
+            co_return;
+        }
+        if (!bucket.overflowed)
+        {
+            break;
+        }
+        index = next_bucket(index);
+    }
+    throw std::out_of_range("Key not found");
+}
+
+template <typename K, typename V>
+void BucketedHashMap<K, V>::vectorized_get_coroutine(const std::vector<K> &keys, std::vector<V> &results, int group_size)
+{
+    interleave(keys.size(), group_size, [&](size_t i)
+               { return get_co(keys[i], results, i); });
+}
+
+template <typename K, typename V>
+void BucketedHashMap<K, V>::vectorized_get_coroutine_exp(const std::vector<K> &keys, std::vector<V> &results, int group_size)
+{
+    interleave(keys.size(), group_size, [&](size_t i)
+               { return get_co_exp(keys[i], results, i); });
+}
+
+template <typename K, typename V>
+void BucketedHashMap<K, V>::profile_vectorized_get_coroutine_exp(const std::vector<K> &keys, std::vector<V> &results, int group_size)
+{
+    interleave(keys.size(), group_size, [&](size_t i)
+               { return profile_get_co_exp(keys[i], results, i); });
+}
+
+template <typename K, typename V>
+void BucketedHashMap<K, V>::remove(const K &key)
+{
+    size_t index = hash(key);
+    for (size_t probes = 0; probes < capacity; ++probes)
+    {
+        auto &bucket = table[index];
+        int slot = find_slot(bucket, key);
+        if (slot >= 0)
+        {
+            // Keep the occupied slots dense by moving the last entry into the hole.
+            bucket.count--;
+            bucket.keys[slot] = bucket.keys[bucket.count];
+            bucket.values[slot] = bucket.values[bucket.count];
+            size--;
+            return;
+        }
+        if (!bucket.overflowed)
+        {
+            break;
+        }
+        index = next_bucket(index);
+    }
+    throw std::out_of_range("Key not found");
+}
+
+template <typename K, typename V>
+bool BucketedHashMap<K, V>::contains(const K &key)
+{
+    size_t index = hash(key);
+    for (size_t probes = 0; probes < capacity; ++probes)
+    {
+        auto &bucket = table[index];
+        if (find_slot(bucket, key) >= 0)
+        {
+            return true;
+        }
+        if (!bucket.overflowed)
+        {
+            return false;
+        }
+        index = next_bucket(index);
+    }
+    return false;
+}
+
+template <typename K, typename V>
+size_t BucketedHashMap<K, V>::getSize() const
+{
+    return size;
+}
+
+template <typename K, typename V>
+bool BucketedHashMap<K, V>::isEmpty() const
+{
+    return size == 0;
+}
+
+template class BucketedHashMap<unsigned int, unsigned int>;
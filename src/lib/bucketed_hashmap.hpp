@@ -0,0 +1,76 @@
+#pragma once
+
+#include <iostream>
+#include <algorithm>
+#include <vector>
+#include <coroutine>
+#include <assert.h>
+
+#include "coroutine.hpp"
+#include "utils/profiler.cpp"
+#include "numa/numa_memory_resource.hpp"
+
+constexpr size_t BUCKET_CACHE_LINE_SIZE = 64;
+
+/*
+    Keys and values are stored inline in cache line aligned buckets. A bucket only
+    overflows into its neighbour (linear probing) when all of its slots are taken.
+    The overflowed flag marks buckets that were full at some point, so lookups can
+    stop at the first bucket that never overflowed.
+*/
+template <typename K, typename V>
+struct alignas(BUCKET_CACHE_LINE_SIZE) Bucket
+{
+    static constexpr size_t SLOTS = std::max(size_t{1}, (BUCKET_CACHE_LINE_SIZE - 2 * sizeof(uint8_t)) / (sizeof(K) + sizeof(V)));
+
+    K keys[SLOTS];
+    V values[SLOTS];
+    uint8_t count = 0;
+    bool overflowed = false;
+};
+
+template <typename K, typename V>
+class BucketedHashMap
+{
+private:
+    std::pmr::vector<Bucket<K, V>> table;
+    size_t size;
+    size_t capacity;
+    std::pmr::memory_resource &memory_resource;
+
+    size_t hash(const K &key);
+    size_t next_bucket(size_t index);
+
+    struct AMAC_state
+    {
+        K key;
+        size_t index;
+        size_t probes;
+        int stage = 0;
+        int i;
+    };
+
+public:
+    PrefetchProfiler &profiler;
+
+    BucketedHashMap(size_t capacity, PrefetchProfiler &profiler, std::pmr::memory_resource &memory_resource);
+    ~BucketedHashMap();
+    void insert(const K &key, const V &value);
+    V &get(const K &key);
+    coroutine get_co(const K &key, std::vector<V> &results, int i);
+    coroutine get_co_exp(const K &key, std::vector<V> &results, int i);
+    coroutine profile_get_co_exp(const K &key, std::vector<V> &results, int i);
+    void vectorized_get(const std::vector<K> &keys, std::vector<V> &results);
+    void vectorized_get_gp(const std::vector<K> &keys, std::vector<V> &results);
+    void vectorized_get_amac(const std::vector<K> &keys, std::vector<V> &results, int group_size);
+    void vectorized_get_coroutine(const std::vector<K> &keys, std::vector<V> &results, int group_size);
+    void vectorized_get_coroutine_exp(const std::vector<K> &keys, std::vector<V> &results, int group_size);
+    void profile_vectorized_get_coroutine_exp(const std::vector<K> &keys, std::vector<V> &results, int group_size);
+    void remove(const K &key);
+    bool contains(const K &key);
+    size_t getSize() const;
+    bool isEmpty() const;
+
+    // Number of buckets required to hold num_keys keys at the given fill factor.
+    static size_t buckets_for(size_t num_keys, double fill_factor = 0.75);
+};
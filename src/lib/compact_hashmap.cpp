@@ -0,0 +1,553 @@
+#include <stdexcept>
+
+#include "compact_hashmap.hpp"
+#include "utils.cpp"
+#include "interleave.hpp"
+
+template <typename K, typename V>
+inline int find_slot(const CompactChunk<K, V> &chunk, const K &key)
+{
+    for (int slot = 0; slot < chunk.count; ++slot)
+    {
+        if (chunk.keys[slot] == key)
+        {
+            return slot;
+        }
+    }
+    return -1;
+}
+
+template <typename K, typename V>
+size_t CompactHashMap<K, V>::hash(const K &key)
+{
+    return std::hash<K>{}(key) % capacity;
+}
+
+template <typename K, typename V>
+uint32_t CompactHashMap<K, V>::allocate_chunk()
+{
+    if (free_chunks != NO_CHUNK)
+    {
+        uint32_t chunk = free_chunks;
+        free_chunks = chunks[chunk].next;
+        chunks[chunk].next = NO_CHUNK;
+        chunks[chunk].count = 0;
+        return chunk;
+    }
+    if (chunks.size() >= EMPTY_BUCKET)
+    {
+        throw std::length_error("CompactHashMap ran out of chunk indices");
+    }
+    chunks.emplace_back();
+    return chunks.size() - 1;
+}
+
+template <typename K, typename V>
+void CompactHashMap<K, V>::free_chunk(uint32_t chunk)
+{
+    chunks[chunk].count = 0;
+    chunks[chunk].next = free_chunks;
+    free_chunks = chunk;
+}
+
+template <typename K, typename V>
+void CompactHashMap<K, V>::hit(std::vector<V> &results, std::vector<bool> *found, size_t i, const V &value)
+{
+    results[i] = value;
+    if (found)
+    {
+        (*found)[i] = true;
+    }
+}
+
+template <typename K, typename V>
+void CompactHashMap<K, V>::miss(std::vector<bool> *found, size_t i)
+{
+    if (!found)
+    {
+        throw std::out_of_range("Key not found.");
+    }
+    (*found)[i] = false;
+}
+
+template <typename K, typename V>
+CompactHashMap<K, V>::CompactHashMap(size_t capacity, PrefetchProfiler &profiler, std::pmr::memory_resource &memory_resource) : table(&memory_resource), chunks(&memory_resource), size(0), capacity(capacity), memory_resource(memory_resource), profiler(profiler)
+{
+    if (capacity == 0)
+    {
+        throw std::invalid_argument("CompactHashMap requires at least one bucket.");
+    }
+    table.resize(capacity);
+}
+
+template <typename K, typename V>
+CompactHashMap<K, V>::~CompactHashMap() {}
+
+template <typename K, typename V>
+void CompactHashMap<K, V>::insert(const K &key, const V &value)
+{
+    auto &bucket = table[hash(key)];
+    if (bucket.overflow == EMPTY_BUCKET)
+    {
+        bucket.key = key;
+        bucket.value = value;
+        bucket.overflow = NO_CHUNK;
+        size++;
+        return;
+    }
+    if (bucket.key == key)
+    {
+        bucket.value = value;
+        return;
+    }
+
+    uint32_t last = NO_CHUNK;
+    for (uint32_t chunk = bucket.overflow; chunk != NO_CHUNK; chunk = chunks[chunk].next)
+    {
+        int slot = find_slot(chunks[chunk], key);
+        if (slot >= 0)
+        {
+            chunks[chunk].values[slot] = value;
+            return;
+        }
+        last = chunk;
+    }
+
+    if (last == NO_CHUNK || chunks[last].count == CompactChunk<K, V>::SLOTS)
+    {
+        uint32_t chunk = allocate_chunk();
+        (last == NO_CHUNK ? bucket.overflow : chunks[last].next) = chunk;
+        last = chunk;
+    }
+    auto &chunk = chunks[last];
+    chunk.keys[chunk.count] = key;
+    chunk.values[chunk.count] = value;
+    chunk.count++;
+    size++;
+}
+
+template <typename K, typename V>
+V &CompactHashMap<K, V>::get(const K &key)
+{
+    auto &bucket = table[hash(key)];
+    if (bucket.overflow != EMPTY_BUCKET)
+    {
+        if (bucket.key == key)
+        {
+            return bucket.value;
+        }
+        for (uint32_t chunk = bucket.overflow; chunk != NO_CHUNK; chunk = chunks[chunk].next)
+        {
+            int slot = find_slot(chunks[chunk], key);
+            if (slot >= 0)
+            {
+                return chunks[chunk].values[slot];
+            }
+        }
+    }
+    throw std::out_of_range("Key not found");
+}
+
+template <typename K, typename V>
+void CompactHashMap<K, V>::vectorized_get(const std::vector<K> &keys, std::vector<V> &results)
+{
+    int i = 0;
+    for (auto &key : keys)
+    {
+        results.at(i) = get(key);
+        i++;
+    }
+}
+
+template <typename K, typename V>
+void CompactHashMap<K, V>::lookup_gp(const std::vector<K> &keys, std::vector<V> &results, std::vector<bool> *found)
+{
+    // states:
+    //  0: Bucket prefetched, compare the inline entry
+    //  1: Chunk prefetched, scan it
+    //  2: Finished
+    std::vector<int> states(keys.size(), 0);
+    std::vector<size_t> indices(keys.size());
+    std::vector<uint32_t> current_chunks(keys.size());
+
+    for (size_t i = 0; i < keys.size(); i++)
+    {
+        indices[i] = hash(keys[i]);
+        __builtin_prefetch(&table[indices[i]], 0, 3);
+    }
+
+    size_t finished = 0;
+    while (finished < keys.size())
+    {
+        for (size_t i = 0; i < keys.size(); i++)
+        {
+            if (states[i] == 2)
+            {
+                continue;
+            }
+            if (states[i] == 0)
+            {
+                auto &bucket = table[indices[i]];
+                if (bucket.overflow == EMPTY_BUCKET)
+                {
+                    miss(found, i);
+                }
+                else if (bucket.key == keys[i])
+                {
+                    hit(results, found, i, bucket.value);
+                }
+                else if (bucket.overflow == NO_CHUNK)
+                {
+                    miss(found, i);
+                }
+                else
+                {
+                    current_chunks[i] = bucket.overflow;
+                    states[i] = 1;
+                    __builtin_prefetch(&chunks[current_chunks[i]], 0, 3);
+                    continue;
+                }
+                states[i] = 2;
+                ++finished;
+                continue;
+            }
+
+            auto &chunk = chunks[current_chunks[i]];
+            int slot = find_slot(chunk, keys[i]);
+            if (slot >= 0)
+            {
+                hit(results, found, i, chunk.values[slot]);
+            }
+            else if (chunk.next == NO_CHUNK)
+            {
+                miss(found, i);
+            }
+            else
+            {
+                current_chunks[i] = chunk.next;
+                __builtin_prefetch(&chunks[current_chunks[i]], 0, 3);
+                continue;
+            }
+            states[i] = 2;
+            ++finished;
+        }
+    }
+}
+
+template <typename K, typename V>
+void CompactHashMap<K, V>::lookup_amac(const std::vector<K> &keys, std::vector<V> &results, std::vector<bool> *found, int group_size)
+{
+    CircularBuffer<AMAC_state> buff(group_size);
+
+    int num_finished = 0;
+    int i = 0;
+    while (num_finished < keys.size())
+    {
+        AMAC_state &state = buff.next_state();
+
+        if (state.stage == 0)
+        {
+            if (i >= keys.size())
+            {
+                continue;
+            }
+            state.i = i;
+            state.key = keys[i++];
+            state.index = hash(state.key);
+            state.stage = 1;
+            __builtin_prefetch(&table[state.index], 0, 3);
+        }
+        else if (state.stage == 1)
+        {
+            auto &bucket = table[state.index];
+            if (bucket.overflow == EMPTY_BUCKET)
+            {
+                miss(found, state.i);
+            }
+            else if (bucket.key == state.key)
+            {
+                hit(results, found, state.i, bucket.value);
+            }
+            else if (bucket.overflow == NO_CHUNK)
+            {
+                miss(found, state.i);
+            }
+            else
+            {
+                state.chunk = bucket.overflow;
+                state.stage = 2;
+                __builtin_prefetch(&chunks[state.chunk], 0, 3);
+                continue;
+            }
+            state.stage = 0;
+            num_finished++;
+        }
+        else if (state.stage == 2)
+        {
+            auto &chunk = chunks[state.chunk];
+            int slot = find_slot(chunk, state.key);
+            if (slot >= 0)
+            {
+                hit(results, found, state.i, chunk.values[slot]);
+            }
+            else if (chunk.next == NO_CHUNK)
+            {
+                miss(found, state.i);
+            }
+            else
+            {
+                state.chunk = chunk.next;
+                __builtin_prefetch(&chunks[state.chunk], 0, 3);
+                continue;
+            }
+            state.stage = 0;
+            num_finished++;
+        }
+    }
+}
+
+template <typename K, typename V>
+coroutine CompactHashMap<K, V>::lookup_co(const K &key, std::vector<V> &results, std::vector<bool> *found, const int i)
+{
+    size_t index = hash(key);
+    __builtin_prefetch(&table[index], 0, 3);
+    co_await std::suspend_always{};
+
+    auto &bucket = table[index];
+    if (bucket.overflow != EMPTY_BUCKET)
+    {
+        if (bucket.key == key)
+        {
+            hit(results, found, i, bucket.value);
+            co_return;
+        }
+        for (uint32_t chunk = bucket.overflow; chunk != NO_CHUNK; chunk = chunks[chunk].next)
+        {
+            __builtin_prefetch(&chunks[chunk], 0, 3);
+            co_await std::suspend_always{};
+
+            int slot = find_slot(chunks[chunk], key);
+            if (slot >= 0)
+            {
+                hit(results, found, i, chunks[chunk].values[slot]);
+                co_return;
+            }
+        }
+    }
+    miss(found, i);
+}
+
+template <typename K, typename V>
+coroutine CompactHashMap<K, V>::lookup_co_exp(const K &key, std::vector<V> &results, std::vector<bool> *found, const int i)
+{
+    size_t index = hash(key);
+    if (!is_in_tlb_and_prefetch(&table[index]))
+    {
+        co_await std::suspend_always{};
+    }
+
+    auto &bucket = table[index];
+    if (bucket.overflow != EMPTY_BUCKET)
+    {
+        if (bucket.key == key)
+        {
+            hit(results, found, i, bucket.value);
+            co_return;
+        }
+        for (uint32_t chunk = bucket.overflow; chunk != NO_CHUNK; chunk = chunks[chunk].next)
+        {
+            if (!is_in_tlb_and_prefetch(&chunks[chunk]))
+            {
+                co_await std::suspend_always{};
+            }
+
+            int slot = find_slot(chunks[chunk], key);
+            if (slot >= 0)
+            {
+                hit(results, found, i, chunks[chunk].values[slot]);
+                co_return;
+            }
+        }
+    }
+    miss(found, i);
+}
+
+template <typename K, typename V>
+template <typename Coroutine>
+void CompactHashMap<K, V>::lookup_coroutine(const std::vector<K> &keys, std::vector<V> &results, std::vector<bool> *found, int group_size, Coroutine coroutine)
+{
+    interleave(keys.size(), group_size, [&](size_t i)
+               { return (this->*coroutine)(keys[i], results, found, i); });
+}
+
+template <typename K, typename V>
+void CompactHashMap<K, V>::vectorized_get_gp(const std::vector<K> &keys, std::vector<V> &results)
+{
+    lookup_gp(keys, results, nullptr);
+}
+
+template <typename K, typename V>
+void CompactHashMap<K, V>::vectorized_get_amac(const std::vector<K> &keys, std::vector<V> &results, int group_size)
+{
+    lookup_amac(keys, results, nullptr, group_size);
+}
+
+template <typename K, typename V>
+void CompactHashMap<K, V>::vectorized_get_coroutine(const std::vector<K> &keys, std::vector<V> &results, int group_size)
+{
+    lookup_coroutine(keys, results, nullptr, group_size, &CompactHashMap::lookup_co);
+}
+
+template <typename K, typename V>
+void CompactHashMap<K, V>::vectorized_get_coroutine_exp(const std::vector<K> &keys, std::vector<V> &results, int group_size)
+{
+    lookup_coroutine(keys, results, nullptr, group_size, &CompactHashMap::lookup_co_exp);
+}
+
+template <typename K, typename V>
+size_t CompactHashMap<K, V>::vectorized_find(const std::vector<K> &keys, std::vector<V> &results, std::vector<bool> &found)
+{
+    found.assign(keys.size(), false);
+    results.resize(keys.size());
+    size_t hits = 0;
+    for (size_t i = 0; i < keys.size(); i++)
+    {
+        found[i] = contains(keys[i]);
+        if (found[i])
+        {
+            results[i] = get(keys[i]);
+            hits++;
+        }
+    }
+    return hits;
+}
+
+template <typename K, typename V>
+size_t CompactHashMap<K, V>::vectorized_find_gp(const std::vector<K> &keys, std::vector<V> &results, std::vector<bool> &found)
+{
+    found.assign(keys.size(), false);
+    results.resize(keys.size());
+    lookup_gp(keys, results, &found);
+    return std::count(found.begin(), found.begin() + keys.size(), true);
+}
+
+template <typename K, typename V>
+size_t CompactHashMap<K, V>::vectorized_find_amac(const std::vector<K> &keys, std::vector<V> &results, std::vector<bool> &found, int group_size)
+{
+    found.assign(keys.size(), false);
+    results.resize(keys.size());
+    lookup_amac(keys, results, &found, group_size);
+    return std::count(found.begin(), found.begin() + keys.size(), true);
+}
+
+template <typename K, typename V>
+size_t CompactHashMap<K, V>::vectorized_find_coroutine(const std::vector<K> &keys, std::vector<V> &results, std::vector<bool> &found, int group_size)
+{
+    found.assign(keys.size(), false);
+    results.resize(keys.size());
+    lookup_coroutine(keys, results, &found, group_size, &CompactHashMap::lookup_co);
+    return std::count(found.begin(), found.begin() + keys.size(), true);
+}
+
+template <typename K, typename V>
+size_t CompactHashMap<K, V>::vectorized_find_coroutine_exp(const std::vector<K> &keys, std::vector<V> &results, std::vector<bool> &found, int group_size)
+{
+    found.assign(keys.size(), false);
+    results.resize(keys.size());
+    lookup_coroutine(keys, results, &found, group_size, &CompactHashMap::lookup_co_exp);
+    return std::count(found.begin(), found.begin() + keys.size(), true);
+}
+
+template <typename K, typename V>
+void CompactHashMap<K, V>::remove(const K &key)
+{
+    auto &bucket = table[hash(key)];
+    if (bucket.overflow == EMPTY_BUCKET)
+    {
+        throw std::out_of_range("Key not found");
+    }
+
+    K *found_key = bucket.key == key ? &bucket.key : nullptr;
+    V *found_value = found_key ? &bucket.value : nullptr;
+    uint32_t last = NO_CHUNK;
+    uint32_t before_last = NO_CHUNK;
+    for (uint32_t chunk = bucket.overflow; chunk != NO_CHUNK; chunk = chunks[chunk].next)
+    {
+        if (!found_key)
+        {
+            int slot = find_slot(chunks[chunk], key);
+            if (slot >= 0)
+            {
+                found_key = &chunks[chunk].keys[slot];
+                found_value = &chunks[chunk].values[slot];
+            }
+        }
+        before_last = last;
+        last = chunk;
+    }
+    if (!found_key)
+    {
+        throw std::out_of_range("Key not found");
+    }
+
+    if (last == NO_CHUNK)
+    {
+        bucket.overflow = EMPTY_BUCKET;
+    }
+    else
+    {
+        // Keep the chain dense by moving its last entry into the hole.
+        auto &chunk = chunks[last];
+        chunk.count--;
+        *found_key = chunk.keys[chunk.count];
+        *found_value = chunk.values[chunk.count];
+        if (chunk.count == 0)
+        {
+            free_chunk(last);
+            (before_last == NO_CHUNK ? bucket.overflow : chunks[before_last].next) = NO_CHUNK;
+        }
+    }
+    size--;
+}
+
+template <typename K, typename V>
+bool CompactHashMap<K, V>::contains(const K &key)
+{
+    auto &bucket = table[hash(key)];
+    if (bucket.overflow == EMPTY_BUCKET)
+    {
+        return false;
+    }
+    if (bucket.key == key)
+    {
+        return true;
+    }
+    for (uint32_t chunk = bucket.overflow; chunk != NO_CHUNK; chunk = chunks[chunk].next)
+    {
+        if (find_slot(chunks[chunk], key) >= 0)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+template <typename K, typename V>
+size_t CompactHashMap<K, V>::getSize() const
+{
+    return size;
+}
+
+template <typename K, typename V>
+bool CompactHashMap<K, V>::isEmpty() const
+{
+    return size == 0;
+}
+
+template <typename K, typename V>
+size_t CompactHashMap<K, V>::memory_usage() const
+{
+    return table.capacity() * sizeof(CompactBucket<K, V>) + chunks.capacity() * sizeof(CompactChunk<K, V>);
+}
+
+template class CompactHashMap<unsigned int, unsigned int>;
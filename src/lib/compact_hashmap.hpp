@@ -0,0 +1,104 @@
+#pragma once
+
+#include <iostream>
+#include <algorithm>
+#include <vector>
+#include <coroutine>
+#include <assert.h>
+
+#include "coroutine.hpp"
+#include "utils/profiler.cpp"
+#include "numa/numa_memory_resource.hpp"
+
+constexpr size_t COMPACT_CHUNK_SIZE = 64;
+
+// Chunks and buckets link to chunks by their 32-bit index into the chunk pool.
+constexpr uint32_t NO_CHUNK = UINT32_MAX;
+// Marks a bucket without an inline entry, a bucket that has one but no overflow links to NO_CHUNK.
+constexpr uint32_t EMPTY_BUCKET = UINT32_MAX - 1;
+
+template <typename K, typename V>
+struct CompactBucket
+{
+    K key;
+    V value;
+    uint32_t overflow = EMPTY_BUCKET;
+};
+
+template <typename K, typename V>
+struct alignas(COMPACT_CHUNK_SIZE) CompactChunk
+{
+    static constexpr size_t SLOTS = std::max(size_t{1}, (COMPACT_CHUNK_SIZE - sizeof(uint32_t) - sizeof(uint8_t)) / (sizeof(K) + sizeof(V)));
+
+    K keys[SLOTS];
+    V values[SLOTS];
+    uint32_t next = NO_CHUNK;
+    uint8_t count = 0;
+};
+
+/*
+    Chained hashing without per node pointers. The first entry of a bucket is stored inline in the bucket array,
+    further entries go into an unrolled chain of cache line sized chunks. Chunks are taken from one pool and
+    referenced by 32-bit indices. A lookup of a key that is alone in its bucket costs a single cache miss.
+
+    Entries of a chain are kept dense: the inline slot is filled first, every chunk but the last one is full.
+*/
+template <typename K, typename V>
+class CompactHashMap
+{
+private:
+    std::pmr::vector<CompactBucket<K, V>> table;
+    std::pmr::vector<CompactChunk<K, V>> chunks;
+    uint32_t free_chunks = NO_CHUNK;
+    size_t size;
+    size_t capacity;
+    std::pmr::memory_resource &memory_resource;
+
+    size_t hash(const K &key);
+    uint32_t allocate_chunk();
+    void free_chunk(uint32_t chunk);
+    // A miss throws if found is nullptr, otherwise it is reported in found.
+    static void hit(std::vector<V> &results, std::vector<bool> *found, size_t i, const V &value);
+    static void miss(std::vector<bool> *found, size_t i);
+
+    coroutine lookup_co(const K &key, std::vector<V> &results, std::vector<bool> *found, int i);
+    coroutine lookup_co_exp(const K &key, std::vector<V> &results, std::vector<bool> *found, int i);
+    void lookup_gp(const std::vector<K> &keys, std::vector<V> &results, std::vector<bool> *found);
+    void lookup_amac(const std::vector<K> &keys, std::vector<V> &results, std::vector<bool> *found, int group_size);
+    template <typename Coroutine>
+    void lookup_coroutine(const std::vector<K> &keys, std::vector<V> &results, std::vector<bool> *found, int group_size, Coroutine coroutine);
+
+    struct AMAC_state
+    {
+        K key;
+        size_t index;
+        uint32_t chunk;
+        int stage = 0;
+        int i;
+    };
+
+public:
+    PrefetchProfiler &profiler;
+
+    CompactHashMap(size_t capacity, PrefetchProfiler &profiler, std::pmr::memory_resource &memory_resource);
+    ~CompactHashMap();
+    void insert(const K &key, const V &value);
+    V &get(const K &key);
+    void vectorized_get(const std::vector<K> &keys, std::vector<V> &results);
+    void vectorized_get_gp(const std::vector<K> &keys, std::vector<V> &results);
+    void vectorized_get_amac(const std::vector<K> &keys, std::vector<V> &results, int group_size);
+    void vectorized_get_coroutine(const std::vector<K> &keys, std::vector<V> &results, int group_size);
+    void vectorized_get_coroutine_exp(const std::vector<K> &keys, std::vector<V> &results, int group_size);
+    // Same as the get variants but a missing key is reported in found instead of throwing.
+    size_t vectorized_find(const std::vector<K> &keys, std::vector<V> &results, std::vector<bool> &found);
+    size_t vectorized_find_gp(const std::vector<K> &keys, std::vector<V> &results, std::vector<bool> &found);
+    size_t vectorized_find_amac(const std::vector<K> &keys, std::vector<V> &results, std::vector<bool> &found, int group_size);
+    size_t vectorized_find_coroutine(const std::vector<K> &keys, std::vector<V> &results, std::vector<bool> &found, int group_size);
+    size_t vectorized_find_coroutine_exp(const std::vector<K> &keys, std::vector<V> &results, std::vector<bool> &found, int group_size);
+    void remove(const K &key);
+    bool contains(const K &key);
+    size_t getSize() const;
+    bool isEmpty() const;
+    // Bytes held by the bucket array and the chunk pool.
+    size_t memory_usage() const;
+};
@@ -0,0 +1,569 @@
+#include <stdexcept>
+#include <new>
+
+#include "concurrent_hashmap.hpp"
+#include "utils.cpp"
+#include "interleave.hpp"
+
+EpochManager::EpochManager() : slots(std::make_shared<Slots>(MAX_THREADS)) {}
+
+EpochManager::~EpochManager()
+{
+    reclaim_all();
+}
+
+EpochManager::Registration &EpochManager::Registration::operator=(Registration &&other) noexcept
+{
+    if (this != &other)
+    {
+        if (slots)
+        {
+            slot->owner.store(std::thread::id{}, std::memory_order_release);
+        }
+        slots = std::move(other.slots);
+        slot = other.slot;
+    }
+    return *this;
+}
+
+EpochManager::Registration::~Registration()
+{
+    if (slots)
+    {
+        slot->owner.store(std::thread::id{}, std::memory_order_release);
+    }
+}
+
+thread_local std::vector<EpochManager::Registration> EpochManager::registrations;
+
+EpochManager::ThreadSlot &EpochManager::thread_slot()
+{
+    for (auto it = registrations.rbegin(); it != registrations.rend(); ++it)
+    {
+        if (it->slots == slots)
+        {
+            return *it->slot;
+        }
+    }
+    return claim_slot();
+}
+
+EpochManager::ThreadSlot &EpochManager::claim_slot()
+{
+    // Registrations of destroyed managers hold the last reference to their slots.
+    std::erase_if(registrations, [](const Registration &registration)
+                  { return registration.slots.use_count() == 1; });
+
+    const auto id = std::this_thread::get_id();
+    const auto start = std::hash<std::thread::id>{}(id) % MAX_THREADS;
+    for (size_t i = 0; i < MAX_THREADS; ++i)
+    {
+        auto &slot = (*slots)[(start + i) % MAX_THREADS];
+        auto owner = slot.owner.load(std::memory_order_acquire);
+        if (owner == std::thread::id{} && slot.owner.compare_exchange_strong(owner, id, std::memory_order_acq_rel))
+        {
+            registrations.emplace_back(slots, &slot);
+            return slot;
+        }
+    }
+    throw std::runtime_error("EpochManager: more than " + std::to_string(MAX_THREADS) + " threads registered at the same time.");
+}
+
+void EpochManager::enter()
+{
+    auto &slot = thread_slot();
+    if (slot.depth++ == 0)
+    {
+        slot.epoch.store(global_epoch.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        // The announcement must be visible before we read any pointer of the data structure.
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+    }
+}
+
+void EpochManager::exit()
+{
+    auto &slot = thread_slot();
+    if (--slot.depth == 0)
+    {
+        slot.epoch.store(INACTIVE, std::memory_order_release);
+    }
+}
+
+void EpochManager::retire(void *p, void (*destroy)(void *), std::size_t bytes, std::size_t alignment, std::pmr::memory_resource &memory_resource)
+{
+    std::lock_guard<std::mutex> lock(retired_mutex);
+    retired.push_back({p, destroy, bytes, alignment, &memory_resource, global_epoch.load(std::memory_order_seq_cst)});
+    if (retired.size() >= 64)
+    {
+        try_advance();
+        reclaim();
+    }
+}
+
+bool EpochManager::try_advance()
+{
+    auto epoch = global_epoch.load(std::memory_order_seq_cst);
+    for (auto &slot : *slots)
+    {
+        auto slot_epoch = slot.epoch.load(std::memory_order_seq_cst);
+        if (slot_epoch != INACTIVE && slot_epoch != epoch)
+        {
+            return false;
+        }
+    }
+    return global_epoch.compare_exchange_strong(epoch, epoch + 1);
+}
+
+void EpochManager::reclaim()
+{
+    auto epoch = global_epoch.load(std::memory_order_seq_cst);
+    auto reclaimable = std::partition(retired.begin(), retired.end(), [&](const Retired &r)
+                                      { return r.epoch + 2 > epoch; });
+    for (auto it = reclaimable; it != retired.end(); ++it)
+    {
+        it->destroy(it->p);
+        it->memory_resource->deallocate(it->p, it->bytes, it->alignment);
+    }
+    retired.erase(reclaimable, retired.end());
+}
+
+void EpochManager::reclaim_all()
+{
+    std::lock_guard<std::mutex> lock(retired_mutex);
+    for (auto &r : retired)
+    {
+        r.destroy(r.p);
+        r.memory_resource->deallocate(r.p, r.bytes, r.alignment);
+    }
+    retired.clear();
+}
+
+template <typename K, typename V>
+size_t ConcurrentHashMap<K, V>::hash(const K &key)
+{
+    return std::hash<K>{}(key) % capacity;
+}
+
+template <typename K, typename V>
+typename ConcurrentHashMap<K, V>::Stripe &ConcurrentHashMap<K, V>::stripe(size_t index)
+{
+    return stripes[index % stripes.size()];
+}
+
+template <typename K, typename V>
+uint64_t ConcurrentHashMap<K, V>::read_version(size_t index)
+{
+    auto &version = stripe(index).version;
+    uint64_t v;
+    while ((v = version.load(std::memory_order_acquire)) & 1)
+    {
+        // A writer holds the stripe.
+        wait_cycles(1);
+    }
+    return v;
+}
+
+template <typename K, typename V>
+bool ConcurrentHashMap<K, V>::validate(size_t index, uint64_t version)
+{
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return stripe(index).version.load(std::memory_order_relaxed) == version;
+}
+
+template <typename K, typename V>
+void ConcurrentHashMap<K, V>::lock(size_t index)
+{
+    auto &version = stripe(index).version;
+    auto v = version.load(std::memory_order_relaxed);
+    while ((v & 1) || !version.compare_exchange_weak(v, v + 1, std::memory_order_acquire, std::memory_order_relaxed))
+    {
+        wait_cycles(1);
+        v = version.load(std::memory_order_relaxed);
+    }
+    std::atomic_thread_fence(std::memory_order_release);
+}
+
+template <typename K, typename V>
+void ConcurrentHashMap<K, V>::unlock(size_t index)
+{
+    stripe(index).version.fetch_add(1, std::memory_order_release);
+}
+
+template <typename K, typename V>
+ConcurrentHashMap<K, V>::ConcurrentHashMap(size_t capacity, PrefetchProfiler &profiler, std::pmr::memory_resource &memory_resource, size_t num_stripes)
+    : capacity(capacity), size(0), profiler(profiler), memory_resource(memory_resource), table(capacity, &memory_resource), stripes(num_stripes, &memory_resource)
+{
+}
+
+template <typename K, typename V>
+ConcurrentHashMap<K, V>::~ConcurrentHashMap()
+{
+    for (auto &bucket : table)
+    {
+        auto node = bucket.load(std::memory_order_relaxed);
+        while (node)
+        {
+            auto next = node->next.load(std::memory_order_relaxed);
+            node->~ConcurrentNode();
+            memory_resource.deallocate(node, sizeof(ConcurrentNode<K, V>), alignof(ConcurrentNode<K, V>));
+            node = next;
+        }
+    }
+}
+
+template <typename K, typename V>
+void ConcurrentHashMap<K, V>::insert(const K &key, const V &value)
+{
+    size_t index = hash(key);
+    lock(index);
+    auto head = table[index].load(std::memory_order_relaxed);
+    for (auto node = head; node; node = node->next.load(std::memory_order_relaxed))
+    {
+        if (node->key == key)
+        {
+            node->value.store(value, std::memory_order_relaxed);
+            unlock(index);
+            return;
+        }
+    }
+    auto memory = memory_resource.allocate(sizeof(ConcurrentNode<K, V>), alignof(ConcurrentNode<K, V>));
+    table[index].store(new (memory) ConcurrentNode<K, V>(key, value, head), std::memory_order_release);
+    size++;
+    unlock(index);
+}
+
+template <typename K, typename V>
+bool ConcurrentHashMap<K, V>::find(const K &key, V &value)
+{
+    size_t index = hash(key);
+    while (true)
+    {
+        uint64_t version = read_version(index);
+        auto node = table[index].load(std::memory_order_acquire);
+        while (node && node->key != key)
+        {
+            node = node->next.load(std::memory_order_acquire);
+        }
+        V found_value{};
+        if (node)
+        {
+            found_value = node->value.load(std::memory_order_relaxed);
+        }
+        if (validate(index, version))
+        {
+            value = found_value;
+            return node != nullptr;
+        }
+    }
+}
+
+template <typename K, typename V>
+V ConcurrentHashMap<K, V>::get(const K &key)
+{
+    EpochGuard guard(epochs);
+    V value;
+    if (!find(key, value))
+    {
+        throw std::out_of_range("Key not found");
+    }
+    return value;
+}
+
+template <typename K, typename V>
+void ConcurrentHashMap<K, V>::vectorized_get(const std::vector<K> &keys, std::vector<V> &results)
+{
+    EpochGuard guard(epochs);
+    int i = 0;
+    for (auto &key : keys)
+    {
+        if (!find(key, results.at(i)))
+        {
+            throw std::out_of_range("Key not found");
+        }
+        i++;
+    }
+}
+
+template <typename K, typename V>
+void ConcurrentHashMap<K, V>::vectorized_get_gp(const std::vector<K> &keys, std::vector<V> &results)
+{
+    EpochGuard guard(epochs);
+    // Every key is processed as AMAC_state, but all keys advance in lock step.
+    // stages:
+    //  1: Bucket prefetched, load first node
+    //  2: Node prefetched, compare key
+    //  0: Finished, element found
+    std::vector<AMAC_state> states(keys.size());
+    for (int i = 0; i < keys.size(); i++)
+    {
+        auto &state = states[i];
+        state.key = keys[i];
+        state.index = hash(state.key);
+        state.version = read_version(state.index);
+        state.stage = 1;
+        __builtin_prefetch(&table[state.index], 0, 3);
+    }
+
+    int finished = 0;
+    while (finished < keys.size())
+    {
+        for (int i = 0; i < keys.size(); i++)
+        {
+            auto &state = states[i];
+            if (state.stage == 0)
+            {
+                continue;
+            }
+            if (state.stage == 1)
+            {
+                state.node = table[state.index].load(std::memory_order_acquire);
+            }
+            else if (state.node->key == state.key)
+            {
+                V value = state.node->value.load(std::memory_order_relaxed);
+                if (validate(state.index, state.version))
+                {
+                    results[i] = value;
+                    state.stage = 0;
+                    ++finished;
+                    continue;
+                }
+                state.node = nullptr;
+            }
+            else
+            {
+                state.node = state.node->next.load(std::memory_order_acquire);
+            }
+
+            if (state.node)
+            {
+                state.stage = 2;
+                __builtin_prefetch(state.node, 0, 3);
+            }
+            else if (validate(state.index, state.version))
+            {
+                throw std::out_of_range("Key not found.");
+            }
+            else
+            {
+                // A writer changed the stripe, restart the lookup.
+                state.version = read_version(state.index);
+                state.stage = 1;
+                __builtin_prefetch(&table[state.index], 0, 3);
+            }
+        }
+    }
+}
+
+template <typename K, typename V>
+void ConcurrentHashMap<K, V>::vectorized_get_amac(const std::vector<K> &keys, std::vector<V> &results, int group_size)
+{
+    EpochGuard guard(epochs);
+    CircularBuffer<AMAC_state> buff(group_size);
+
+    int num_finished = 0;
+    int i = 0;
+    while (num_finished < keys.size())
+    {
+        AMAC_state &state = buff.next_state();
+
+        if (state.stage == 0)
+        {
+            if (i >= keys.size())
+            {
+                continue;
+            }
+            state.i = i;
+            state.key = keys[i++];
+            state.index = hash(state.key);
+            state.version = read_version(state.index);
+            state.stage = 1;
+            __builtin_prefetch(&table[state.index], 0, 3);
+            continue;
+        }
+
+        if (state.stage == 1)
+        {
+            state.node = table[state.index].load(std::memory_order_acquire);
+        }
+        else if (state.node->key == state.key)
+        {
+            V value = state.node->value.load(std::memory_order_relaxed);
+            if (validate(state.index, state.version))
+            {
+                state.stage = 0;
+                results[state.i] = value;
+                num_finished++;
+                continue;
+            }
+            state.node = nullptr;
+        }
+        else
+        {
+            state.node = state.node->next.load(std::memory_order_acquire);
+        }
+
+        if (state.node)
+        {
+            state.stage = 2;
+            __builtin_prefetch(state.node, 0, 3);
+        }
+        else if (validate(state.index, state.version))
+        {
+            throw std::out_of_range("Key not found.");
+        }
+        else
+        {
+            // A writer changed the stripe, restart the lookup.
+            state.version = read_version(state.index);
+            state.stage = 1;
+            __builtin_prefetch(&table[state.index], 0, 3);
+        }
+    }
+}
+
+template <typename K, typename V>
+coroutine ConcurrentHashMap<K, V>::get_co(const K &key, std::vector<V> &results, const int i)
+{
+    size_t index = hash(key);
+    while (true)
+    {
+        uint64_t version = read_version(index);
+
+        // prefetch bucket (list head)
+        __builtin_prefetch(&table[index], 0, 3);
+        co_await std::suspend_always{};
+
+        auto node = table[index].load(std::memory_order_acquire);
+        while (node)
+        {
+            __builtin_prefetch(node, 0, 3);
+            co_await std::suspend_always{};
+            if (node->key == key)
+            {
+                break;
+            }
+            node = node->next.load(std::memory_order_acquire);
+        }
+        if (node)
+        {
+            V value = node->value.load(std::memory_order_relaxed);
+            if (validate(index, version))
+            {
+                results.at(i) = value;
+                co_return;
+            }
+        }
+        else if (validate(index, version))
+        {
+            break;
+        }
+    }
+    throw std::out_of_range("Key not found");
+}
+
+template <typename K, typename V>
+coroutine ConcurrentHashMap<K, V>::get_co_exp(const K &key, std::vector<V> &results, const int i)
+{
+    size_t index = hash(key);
+    while (true)
+    {
+        uint64_t version = read_version(index);
+
+        if (!is_in_tlb_and_prefetch(&table[index]))
+        {
+            co_await std::suspend_always{};
+        }
+
+        auto node = table[index].load(std::memory_order_acquire);
+        while (node)
+        {
+            if (!is_in_tlb_and_prefetch(node))
+            {
+                co_await std::suspend_always{};
+            }
+            if (node->key == key)
+            {
+                break;
+            }
+            node = node->next.load(std::memory_order_acquire);
+        }
+        if (node)
+        {
+            V value = node->value.load(std::memory_order_relaxed);
+            if (validate(index, version))
+            {
+                results.at(i) = value;
+                co_return;
+            }
+        }
+        else if (validate(index, version))
+        {
+            break;
+        }
+    }
+    throw std::out_of_range("Key not found");
+}
+
+template <typename K, typename V>
+void ConcurrentHashMap<K, V>::vectorized_get_coroutine(const std::vector<K> &keys, std::vector<V> &results, int group_size)
+{
+    // Suspended coroutines hold node pointers, the epoch must cover the whole batch.
+    EpochGuard guard(epochs);
+    interleave(keys.size(), group_size, [&](size_t i)
+               { return get_co(keys[i], results, i); });
+}
+
+template <typename K, typename V>
+void ConcurrentHashMap<K, V>::vectorized_get_coroutine_exp(const std::vector<K> &keys, std::vector<V> &results, int group_size)
+{
+    // Suspended coroutines hold node pointers, the epoch must cover the whole batch.
+    EpochGuard guard(epochs);
+    interleave(keys.size(), group_size, [&](size_t i)
+               { return get_co_exp(keys[i], results, i); });
+}
+
+template <typename K, typename V>
+void ConcurrentHashMap<K, V>::remove(const K &key)
+{
+    size_t index = hash(key);
+    lock(index);
+    std::atomic<ConcurrentNode<K, V> *> *link = &table[index];
+    for (auto node = link->load(std::memory_order_relaxed); node; node = link->load(std::memory_order_relaxed))
+    {
+        if (node->key == key)
+        {
+            // Readers may still be on the node, it is freed once their epoch is over.
+            link->store(node->next.load(std::memory_order_relaxed), std::memory_order_release);
+            size--;
+            unlock(index);
+            epochs.retire(node, memory_resource);
+            return;
+        }
+        link = &node->next;
+    }
+    unlock(index);
+    throw std::out_of_range("Key not found");
+}
+
+template <typename K, typename V>
+bool ConcurrentHashMap<K, V>::contains(const K &key)
+{
+    EpochGuard guard(epochs);
+    V value;
+    return find(key, value);
+}
+
+template <typename K, typename V>
+size_t ConcurrentHashMap<K, V>::getSize() const
+{
+    return size;
+}
+
+template <typename K, typename V>
+bool ConcurrentHashMap<K, V>::isEmpty() const
+{
+    return size == 0;
+}
+
+template class ConcurrentHashMap<unsigned int, unsigned int>;
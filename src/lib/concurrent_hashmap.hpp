@@ -0,0 +1,177 @@
+#pragma once
+
+#include <iostream>
+#include <vector>
+#include <coroutine>
+#include <atomic>
+#include <limits>
+#include <mutex>
+#include <thread>
+#include <memory>
+#include <assert.h>
+
+#include "coroutine.hpp"
+#include "utils/profiler.cpp"
+#include "numa/numa_memory_resource.hpp"
+
+/*
+    Epoch based reclamation: readers announce the global epoch they started in, writers tag unlinked memory
+    with the epoch it was retired in. Memory retired in epoch e is no longer reachable by any reader once the
+    global epoch reached e + 2, because the epoch only advances when every active reader observed it.
+*/
+class EpochManager
+{
+public:
+    static constexpr size_t MAX_THREADS = 256;
+    static constexpr uint64_t INACTIVE = std::numeric_limits<uint64_t>::max();
+
+    EpochManager();
+    ~EpochManager();
+
+    void enter();
+    void exit();
+    // Destroys and frees object once no reader can reach it anymore.
+    template <typename T>
+    void retire(T *object, std::pmr::memory_resource &memory_resource);
+    // Frees all retired memory. Only call this when no reader is active anymore.
+    void reclaim_all();
+
+private:
+    struct alignas(64) ThreadSlot
+    {
+        std::atomic<std::thread::id> owner{};
+        std::atomic<uint64_t> epoch{INACTIVE};
+        uint32_t depth = 0; // only accessed by the owning thread, allows nested guards
+    };
+
+    using Slots = std::vector<ThreadSlot>;
+
+    // A thread's claim of a slot, released when the thread exits. The registration shares the slots, so it
+    // outlives a manager that is destroyed first.
+    struct Registration
+    {
+        std::shared_ptr<Slots> slots;
+        ThreadSlot *slot;
+
+        Registration(std::shared_ptr<Slots> slots, ThreadSlot *slot) : slots(std::move(slots)), slot(slot) {}
+        Registration(Registration &&other) noexcept : slots(std::move(other.slots)), slot(other.slot) {}
+        Registration &operator=(Registration &&other) noexcept;
+        ~Registration();
+    };
+
+    struct Retired
+    {
+        void *p;
+        void (*destroy)(void *);
+        std::size_t bytes;
+        std::size_t alignment;
+        std::pmr::memory_resource *memory_resource;
+        uint64_t epoch;
+    };
+
+    // The slots of the managers the calling thread used, most recently claimed last.
+    static thread_local std::vector<Registration> registrations;
+
+    ThreadSlot &thread_slot();
+    ThreadSlot &claim_slot();
+    void retire(void *p, void (*destroy)(void *), std::size_t bytes, std::size_t alignment, std::pmr::memory_resource &memory_resource);
+    bool try_advance();
+    void reclaim();
+
+    std::atomic<uint64_t> global_epoch{0};
+    std::shared_ptr<Slots> slots;
+    std::mutex retired_mutex;
+    std::vector<Retired> retired;
+};
+
+template <typename T>
+void EpochManager::retire(T *object, std::pmr::memory_resource &memory_resource)
+{
+    retire(object, [](void *p)
+           { static_cast<T *>(p)->~T(); }, sizeof(T), alignof(T), memory_resource);
+}
+
+// Keeps the calling thread inside an epoch for the lifetime of the guard.
+class EpochGuard
+{
+public:
+    explicit EpochGuard(EpochManager &manager) : manager(manager) { manager.enter(); }
+    ~EpochGuard() { manager.exit(); }
+    EpochGuard(const EpochGuard &) = delete;
+    EpochGuard &operator=(const EpochGuard &) = delete;
+
+private:
+    EpochManager &manager;
+};
+
+template <typename K, typename V>
+class ConcurrentNode
+{
+public:
+    const K key;
+    std::atomic<V> value;
+    std::atomic<ConcurrentNode *> next;
+
+    ConcurrentNode(const K &key, const V &value, ConcurrentNode *next) : key(key), value(value), next(next) {}
+};
+
+/*
+    Writers lock the stripe of a bucket by making its version odd and publish their change by making it even
+    again. Readers never lock: they remember the (even) version of the stripe before touching the bucket and
+    retry the lookup if it changed until they read the value. Unlinked nodes are reclaimed through epochs, so
+    readers may still follow pointers into nodes that were removed while they were suspended.
+*/
+template <typename K, typename V>
+class ConcurrentHashMap
+{
+private:
+    struct alignas(64) Stripe
+    {
+        std::atomic<uint64_t> version{0};
+    };
+
+    std::pmr::vector<std::atomic<ConcurrentNode<K, V> *>> table;
+    std::pmr::vector<Stripe> stripes;
+    std::atomic<size_t> size;
+    size_t capacity;
+    std::pmr::memory_resource &memory_resource;
+    EpochManager epochs;
+
+    size_t hash(const K &key);
+    Stripe &stripe(size_t index);
+    uint64_t read_version(size_t index);
+    bool validate(size_t index, uint64_t version);
+    void lock(size_t index);
+    void unlock(size_t index);
+    // Lookup without entering an epoch, the caller must hold an EpochGuard.
+    bool find(const K &key, V &value);
+
+    struct AMAC_state
+    {
+        K key;
+        size_t index;
+        uint64_t version;
+        ConcurrentNode<K, V> *node;
+        int stage = 0;
+        int i;
+    };
+
+public:
+    PrefetchProfiler &profiler;
+
+    ConcurrentHashMap(size_t capacity, PrefetchProfiler &profiler, std::pmr::memory_resource &memory_resource, size_t num_stripes = 4096);
+    ~ConcurrentHashMap();
+    void insert(const K &key, const V &value);
+    V get(const K &key);
+    coroutine get_co(const K &key, std::vector<V> &results, int i);
+    coroutine get_co_exp(const K &key, std::vector<V> &results, int i);
+    void vectorized_get(const std::vector<K> &keys, std::vector<V> &results);
+    void vectorized_get_gp(const std::vector<K> &keys, std::vector<V> &results);
+    void vectorized_get_amac(const std::vector<K> &keys, std::vector<V> &results, int group_size);
+    void vectorized_get_coroutine(const std::vector<K> &keys, std::vector<V> &results, int group_size);
+    void vectorized_get_coroutine_exp(const std::vector<K> &keys, std::vector<V> &results, int group_size);
+    void remove(const K &key);
+    bool contains(const K &key);
+    size_t getSize() const;
+    bool isEmpty() const;
+};
@@ -1,6 +1,87 @@
 #pragma once
 #include <coroutine>
 #include <cstdint>
+#include <cstddef>
+#include <atomic>
+#include <new>
+#include <optional>
+#include <exception>
+#include <utility>
+#include <type_traits>
+
+/*
+    Recycles the coroutine frames of one thread. Frames are rounded up to size classes of 64 bytes and cached in a
+    LIFO list per class, a batch that creates and destroys one frame per lookup keeps reusing the group_size frames
+    it has in flight, which are still hot in L1. The pool is thread local and frames are allocated by the thread
+    that first needs them, so with pinned threads they are placed on the local NUMA node by first touch.
+*/
+class FramePool
+{
+public:
+    static constexpr size_t CLASS_SIZE = 64;
+    static constexpr size_t NUM_CLASSES = 32;
+    static constexpr size_t MAX_CACHED_FRAMES = 4096;
+
+    // Switches between pooled frames and plain operator new / delete for every thread.
+    static inline std::atomic<bool> enabled{true};
+
+    static FramePool &local()
+    {
+        thread_local FramePool pool;
+        return pool;
+    }
+
+    FramePool() = default;
+    FramePool(const FramePool &) = delete;
+    FramePool &operator=(const FramePool &) = delete;
+
+    ~FramePool()
+    {
+        for (auto head : free_frames)
+        {
+            while (head)
+            {
+                void *next = *static_cast<void **>(head);
+                ::operator delete(head);
+                head = next;
+            }
+        }
+    }
+
+    void *allocate(size_t size)
+    {
+        size_t size_class = (size + CLASS_SIZE - 1) / CLASS_SIZE;
+        if (size_class >= NUM_CLASSES)
+        {
+            return ::operator new(size);
+        }
+        if (void *frame = free_frames[size_class]; frame && enabled.load(std::memory_order_relaxed))
+        {
+            free_frames[size_class] = *static_cast<void **>(frame);
+            cached[size_class]--;
+            return frame;
+        }
+        // Allocate the whole class so that any frame of the class can be reused.
+        return ::operator new(size_class * CLASS_SIZE);
+    }
+
+    void deallocate(void *frame, size_t size)
+    {
+        size_t size_class = (size + CLASS_SIZE - 1) / CLASS_SIZE;
+        if (size_class >= NUM_CLASSES || cached[size_class] >= MAX_CACHED_FRAMES || !enabled.load(std::memory_order_relaxed))
+        {
+            ::operator delete(frame);
+            return;
+        }
+        *static_cast<void **>(frame) = free_frames[size_class];
+        free_frames[size_class] = frame;
+        cached[size_class]++;
+    }
+
+private:
+    void *free_frames[NUM_CLASSES] = {};
+    size_t cached[NUM_CLASSES] = {};
+};
 
 struct promise;
 
@@ -17,24 +98,168 @@ struct promise
     void return_void() {}
     void unhandled_exception() {}
 
+    static void *operator new(size_t size) { return FramePool::local().allocate(size); }
+    static void operator delete(void *frame, size_t size) { FramePool::local().deallocate(frame, size); }
 };
 
-struct task
+template <typename T = void>
+class task;
+
+/*
+    Shared by the promises of all tasks. A task that awaits another task forms a chain with it, the outermost
+    task of the chain stores the innermost coroutine (leaf) that is currently suspended. When a nested task
+    suspends, e.g. after issuing a prefetch, the whole chain returns to the scheduler, which resumes the leaf
+    through the outermost task. Control is passed between the tasks of a chain by symmetric transfer, so
+    awaiting a task neither grows the stack nor returns to the scheduler.
+*/
+struct task_promise_base
 {
-    struct promise_type
+    struct chain
+    {
+        std::coroutine_handle<> leaf;
+        uint16_t next_node = 0;
+    };
+
+    chain own_chain;
+    chain *root = &own_chain;
+    std::coroutine_handle<> continuation;
+    std::exception_ptr exception;
+
+    struct final_awaiter
     {
-        task get_return_object() { return task{std::coroutine_handle<promise_type>::from_promise(*this)}; }
-        std::suspend_always initial_suspend() { return {}; }
-        std::suspend_never final_suspend() noexcept { return {}; }
-        void return_void() {}
-        void unhandled_exception() {}
+        bool await_ready() noexcept { return false; }
+        template <typename Promise>
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> h) noexcept
+        {
+            auto &promise = h.promise();
+            if (promise.continuation)
+            {
+                promise.root->leaf = promise.continuation;
+                return promise.continuation;
+            }
+            return std::noop_coroutine();
+        }
+        void await_resume() noexcept {}
     };
-    std::coroutine_handle<promise_type> coro;
-    bool empty = false;
-    uint16_t next_node = 0;
-    task(std::coroutine_handle<promise_type> h) : coro(h) {}
-    task()
+
+    std::suspend_always initial_suspend() noexcept { return {}; }
+    final_awaiter final_suspend() noexcept { return {}; }
+    void unhandled_exception() { exception = std::current_exception(); }
+
+    static void *operator new(size_t size) { return FramePool::local().allocate(size); }
+    static void operator delete(void *frame, size_t size) { FramePool::local().deallocate(frame, size); }
+};
+
+template <typename T>
+struct task_promise : task_promise_base
+{
+    std::optional<T> value;
+
+    task<T> get_return_object();
+    void return_value(T v) { value.emplace(std::move(v)); }
+    T result()
+    {
+        if (exception)
+        {
+            std::rethrow_exception(exception);
+        }
+        return std::move(*value);
+    }
+};
+
+template <>
+struct task_promise<void> : task_promise_base
+{
+    task<void> get_return_object();
+    void return_void() {}
+    void result()
+    {
+        if (exception)
+        {
+            std::rethrow_exception(exception);
+        }
+    }
+};
+
+/*
+    Lazily started coroutine that owns its frame and can be awaited by other tasks, co_await yields the value
+    of its co_return. A scheduler resumes the outermost task of a chain until done() and collects the value or
+    exception with result().
+*/
+template <typename T>
+class task
+{
+public:
+    using promise_type = task_promise<T>;
+
+    task() = default;
+    explicit task(std::coroutine_handle<promise_type> h) : handle(h)
+    {
+        h.promise().own_chain.leaf = h;
+    }
+    task(task &&other) noexcept : handle(std::exchange(other.handle, nullptr)) {}
+    task &operator=(task &&other) noexcept
     {
-        empty = true;
+        if (this != &other)
+        {
+            if (handle)
+            {
+                handle.destroy();
+            }
+            handle = std::exchange(other.handle, nullptr);
+        }
+        return *this;
     }
-};
\ No newline at end of file
+    task(const task &) = delete;
+    task &operator=(const task &) = delete;
+    ~task()
+    {
+        if (handle)
+        {
+            handle.destroy();
+        }
+    }
+
+    explicit operator bool() const { return static_cast<bool>(handle); }
+    bool done() const { return handle.done(); }
+    void resume() { handle.promise().root->leaf.resume(); }
+    T result() { return handle.promise().result(); }
+
+    // NUMA node the chain asked to continue on, see jump_to_other_node in the tree simulation.
+    uint16_t &next_node() { return handle.promise().own_chain.next_node; }
+
+    struct awaiter
+    {
+        std::coroutine_handle<promise_type> callee;
+        bool await_ready() noexcept { return !callee || callee.done(); }
+        template <typename Promise>
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> caller) noexcept
+        {
+            auto &promise = callee.promise();
+            promise.continuation = caller;
+            if constexpr (std::is_base_of_v<task_promise_base, Promise>)
+            {
+                promise.root = caller.promise().root;
+            }
+            promise.root->leaf = callee;
+            return callee;
+        }
+        T await_resume() { return callee.promise().result(); }
+    };
+
+    awaiter operator co_await() && noexcept { return awaiter{handle}; }
+
+private:
+    std::coroutine_handle<promise_type> handle;
+};
+
+template <typename T>
+task<T> task_promise<T>::get_return_object()
+{
+    return task<T>{std::coroutine_handle<task_promise<T>>::from_promise(*this)};
+}
+
+inline task<void> task_promise<void>::get_return_object()
+{
+    return task<void>{std::coroutine_handle<task_promise<void>>::from_promise(*this)};
+}
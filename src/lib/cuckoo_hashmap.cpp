@@ -0,0 +1,372 @@
+#include <cmath>
+#include <stdexcept>
+
+#include "cuckoo_hashmap.hpp"
+#include "utils.cpp"
+#include "interleave.hpp"
+
+template <typename K, typename V>
+inline int find_slot(const CuckooBucket<K, V> &bucket, const K &key)
+{
+    for (int slot = 0; slot < bucket.count; ++slot)
+    {
+        if (bucket.keys[slot] == key)
+        {
+            return slot;
+        }
+    }
+    return -1;
+}
+
+template <typename K, typename V>
+typename CuckooHashMap<K, V>::Candidates CuckooHashMap<K, V>::candidates(const K &key)
+{
+    // fmix64 of MurmurHash3, both bucket indices are taken from independent halves of the result.
+    uint64_t h = std::hash<K>{}(key);
+    h ^= h >> 33;
+    h *= 0xFF51AFD7ED558CCDull;
+    h ^= h >> 33;
+    h *= 0xC4CEB9FE1A85EC53ull;
+    h ^= h >> 33;
+
+    size_t first = ((h >> 32) * capacity) >> 32;
+    size_t second = ((h & 0xFFFFFFFFull) * capacity) >> 32;
+    if (second == first && capacity > 1)
+    {
+        second = first + 1 == capacity ? 0 : first + 1;
+    }
+    return {first, second};
+}
+
+template <typename K, typename V>
+size_t CuckooHashMap<K, V>::alternative(const K &key, size_t bucket)
+{
+    Candidates buckets = candidates(key);
+    return bucket == buckets.first ? buckets.second : buckets.first;
+}
+
+template <typename K, typename V>
+bool CuckooHashMap<K, V>::lookup(const K &key, const Candidates &buckets, std::vector<V> &results, std::vector<bool> *found, size_t i)
+{
+    for (size_t index : {buckets.first, buckets.second})
+    {
+        auto &bucket = table[index];
+        int slot = find_slot(bucket, key);
+        if (slot >= 0)
+        {
+            results[i] = bucket.values[slot];
+            if (found)
+            {
+                (*found)[i] = true;
+            }
+            return true;
+        }
+    }
+    if (!found)
+    {
+        throw std::out_of_range("Key not found.");
+    }
+    (*found)[i] = false;
+    return false;
+}
+
+template <typename K, typename V>
+CuckooHashMap<K, V>::CuckooHashMap(size_t capacity, PrefetchProfiler &profiler, std::pmr::memory_resource &memory_resource) : capacity(capacity), size(0), profiler(profiler), memory_resource(memory_resource), table(&memory_resource)
+{
+    if (capacity == 0 || capacity > 0xFFFFFFFFull)
+    {
+        throw std::invalid_argument("CuckooHashMap requires between one and 2^32 buckets.");
+    }
+    table.resize(capacity);
+}
+
+template <typename K, typename V>
+CuckooHashMap<K, V>::~CuckooHashMap() {}
+
+template <typename K, typename V>
+size_t CuckooHashMap<K, V>::buckets_for(size_t num_keys, double fill_factor)
+{
+    return std::max(size_t{2}, static_cast<size_t>(std::ceil(num_keys / (CuckooBucket<K, V>::SLOTS * fill_factor))));
+}
+
+template <typename K, typename V>
+void CuckooHashMap<K, V>::insert(const K &key, const V &value)
+{
+    Candidates buckets = candidates(key);
+    for (size_t index : {buckets.first, buckets.second})
+    {
+        auto &bucket = table[index];
+        int slot = find_slot(bucket, key);
+        if (slot >= 0)
+        {
+            bucket.values[slot] = value;
+            return;
+        }
+    }
+
+    size_t index = table[buckets.second].count < table[buckets.first].count ? buckets.second : buckets.first;
+    K evicted_key = key;
+    V evicted_value = value;
+    std::vector<std::pair<size_t, int>> path;
+    for (size_t evictions = 0; evictions <= MAX_EVICTIONS; ++evictions)
+    {
+        auto &bucket = table[index];
+        if (bucket.count < CuckooBucket<K, V>::SLOTS)
+        {
+            bucket.keys[bucket.count] = evicted_key;
+            bucket.values[bucket.count] = evicted_value;
+            bucket.count++;
+            size++;
+            return;
+        }
+        if (evictions == MAX_EVICTIONS)
+        {
+            break;
+        }
+
+        // xorshift64, picks the victim slot of the random walk.
+        eviction_seed ^= eviction_seed << 13;
+        eviction_seed ^= eviction_seed >> 7;
+        eviction_seed ^= eviction_seed << 17;
+        int slot = eviction_seed % CuckooBucket<K, V>::SLOTS;
+        std::swap(evicted_key, bucket.keys[slot]);
+        std::swap(evicted_value, bucket.values[slot]);
+        path.emplace_back(index, slot);
+        index = alternative(evicted_key, index);
+    }
+
+    // Undo the random walk, so a failed insert leaves the map unchanged.
+    for (auto it = path.rbegin(); it != path.rend(); ++it)
+    {
+        std::swap(evicted_key, table[it->first].keys[it->second]);
+        std::swap(evicted_value, table[it->first].values[it->second]);
+    }
+    throw std::length_error("CuckooHashMap is full");
+}
+
+template <typename K, typename V>
+V &CuckooHashMap<K, V>::get(const K &key)
+{
+    Candidates buckets = candidates(key);
+    for (size_t index : {buckets.first, buckets.second})
+    {
+        auto &bucket = table[index];
+        int slot = find_slot(bucket, key);
+        if (slot >= 0)
+        {
+            return bucket.values[slot];
+        }
+    }
+    throw std::out_of_range("Key not found");
+}
+
+template <typename K, typename V>
+void CuckooHashMap<K, V>::vectorized_get(const std::vector<K> &keys, std::vector<V> &results)
+{
+    int i = 0;
+    for (auto &key : keys)
+    {
+        results.at(i) = get(key);
+        i++;
+    }
+}
+
+template <typename K, typename V>
+void CuckooHashMap<K, V>::lookup_gp(const std::vector<K> &keys, std::vector<V> &results, std::vector<bool> *found)
+{
+    // Every key needs exactly one round: prefetch both candidate buckets of all keys, then scan them.
+    std::vector<Candidates> buckets(keys.size());
+    for (size_t i = 0; i < keys.size(); i++)
+    {
+        buckets[i] = candidates(keys[i]);
+        __builtin_prefetch(&table[buckets[i].first], 0, 3);
+        __builtin_prefetch(&table[buckets[i].second], 0, 3);
+    }
+
+    for (size_t i = 0; i < keys.size(); i++)
+    {
+        lookup(keys[i], buckets[i], results, found, i);
+    }
+}
+
+template <typename K, typename V>
+void CuckooHashMap<K, V>::lookup_amac(const std::vector<K> &keys, std::vector<V> &results, std::vector<bool> *found, int group_size)
+{
+    CircularBuffer<AMAC_state> buff(group_size);
+
+    int num_finished = 0;
+    int i = 0;
+    while (num_finished < keys.size())
+    {
+        AMAC_state &state = buff.next_state();
+
+        if (state.stage == 0)
+        {
+            if (i >= keys.size())
+            {
+                continue;
+            }
+            state.i = i;
+            state.key = keys[i++];
+            state.buckets = candidates(state.key);
+            state.stage = 1;
+            __builtin_prefetch(&table[state.buckets.first], 0, 3);
+            __builtin_prefetch(&table[state.buckets.second], 0, 3);
+        }
+        else if (state.stage == 1)
+        {
+            lookup(state.key, state.buckets, results, found, state.i);
+            state.stage = 0;
+            num_finished++;
+        }
+    }
+}
+
+template <typename K, typename V>
+coroutine CuckooHashMap<K, V>::lookup_co(const K &key, std::vector<V> &results, std::vector<bool> *found, const int i)
+{
+    Candidates buckets = candidates(key);
+    __builtin_prefetch(&table[buckets.first], 0, 3);
+    __builtin_prefetch(&table[buckets.second], 0, 3);
+    co_await std::suspend_always{};
+
+    lookup(key, buckets, results, found, i);
+}
+
+template <typename K, typename V>
+coroutine CuckooHashMap<K, V>::lookup_co_exp(const K &key, std::vector<V> &results, std::vector<bool> *found, const int i)
+{
+    Candidates buckets = candidates(key);
+    // Both prefetches have to be issued, so no short circuit evaluation.
+    bool first_cached = is_in_tlb_and_prefetch(&table[buckets.first]);
+    bool second_cached = is_in_tlb_and_prefetch(&table[buckets.second]);
+    if (!first_cached || !second_cached)
+    {
+        co_await std::suspend_always{};
+    }
+
+    lookup(key, buckets, results, found, i);
+}
+
+template <typename K, typename V>
+template <typename Coroutine>
+void CuckooHashMap<K, V>::lookup_coroutine(const std::vector<K> &keys, std::vector<V> &results, std::vector<bool> *found, int group_size, Coroutine coroutine)
+{
+    interleave(keys.size(), group_size, [&](size_t i)
+               { return (this->*coroutine)(keys[i], results, found, i); });
+}
+
+template <typename K, typename V>
+void CuckooHashMap<K, V>::vectorized_get_gp(const std::vector<K> &keys, std::vector<V> &results)
+{
+    lookup_gp(keys, results, nullptr);
+}
+
+template <typename K, typename V>
+void CuckooHashMap<K, V>::vectorized_get_amac(const std::vector<K> &keys, std::vector<V> &results, int group_size)
+{
+    lookup_amac(keys, results, nullptr, group_size);
+}
+
+template <typename K, typename V>
+void CuckooHashMap<K, V>::vectorized_get_coroutine(const std::vector<K> &keys, std::vector<V> &results, int group_size)
+{
+    lookup_coroutine(keys, results, nullptr, group_size, &CuckooHashMap::lookup_co);
+}
+
+template <typename K, typename V>
+void CuckooHashMap<K, V>::vectorized_get_coroutine_exp(const std::vector<K> &keys, std::vector<V> &results, int group_size)
+{
+    lookup_coroutine(keys, results, nullptr, group_size, &CuckooHashMap::lookup_co_exp);
+}
+
+template <typename K, typename V>
+size_t CuckooHashMap<K, V>::vectorized_find(const std::vector<K> &keys, std::vector<V> &results, std::vector<bool> &found)
+{
+    found.assign(keys.size(), false);
+    results.resize(keys.size());
+    size_t hits = 0;
+    for (size_t i = 0; i < keys.size(); i++)
+    {
+        hits += lookup(keys[i], candidates(keys[i]), results, &found, i);
+    }
+    return hits;
+}
+
+template <typename K, typename V>
+size_t CuckooHashMap<K, V>::vectorized_find_gp(const std::vector<K> &keys, std::vector<V> &results, std::vector<bool> &found)
+{
+    found.assign(keys.size(), false);
+    results.resize(keys.size());
+    lookup_gp(keys, results, &found);
+    return std::count(found.begin(), found.begin() + keys.size(), true);
+}
+
+template <typename K, typename V>
+size_t CuckooHashMap<K, V>::vectorized_find_amac(const std::vector<K> &keys, std::vector<V> &results, std::vector<bool> &found, int group_size)
+{
+    found.assign(keys.size(), false);
+    results.resize(keys.size());
+    lookup_amac(keys, results, &found, group_size);
+    return std::count(found.begin(), found.begin() + keys.size(), true);
+}
+
+template <typename K, typename V>
+size_t CuckooHashMap<K, V>::vectorized_find_coroutine(const std::vector<K> &keys, std::vector<V> &results, std::vector<bool> &found, int group_size)
+{
+    found.assign(keys.size(), false);
+    results.resize(keys.size());
+    lookup_coroutine(keys, results, &found, group_size, &CuckooHashMap::lookup_co);
+    return std::count(found.begin(), found.begin() + keys.size(), true);
+}
+
+template <typename K, typename V>
+size_t CuckooHashMap<K, V>::vectorized_find_coroutine_exp(const std::vector<K> &keys, std::vector<V> &results, std::vector<bool> &found, int group_size)
+{
+    found.assign(keys.size(), false);
+    results.resize(keys.size());
+    lookup_coroutine(keys, results, &found, group_size, &CuckooHashMap::lookup_co_exp);
+    return std::count(found.begin(), found.begin() + keys.size(), true);
+}
+
+template <typename K, typename V>
+void CuckooHashMap<K, V>::remove(const K &key)
+{
+    Candidates buckets = candidates(key);
+    for (size_t index : {buckets.first, buckets.second})
+    {
+        auto &bucket = table[index];
+        int slot = find_slot(bucket, key);
+        if (slot >= 0)
+        {
+            // Keep the occupied slots dense by moving the last entry into the hole.
+            bucket.count--;
+            bucket.keys[slot] = bucket.keys[bucket.count];
+            bucket.values[slot] = bucket.values[bucket.count];
+            size--;
+            return;
+        }
+    }
+    throw std::out_of_range("Key not found");
+}
+
+template <typename K, typename V>
+bool CuckooHashMap<K, V>::contains(const K &key)
+{
+    Candidates buckets = candidates(key);
+    return find_slot(table[buckets.first], key) >= 0 || find_slot(table[buckets.second], key) >= 0;
+}
+
+template <typename K, typename V>
+size_t CuckooHashMap<K, V>::getSize() const
+{
+    return size;
+}
+
+template <typename K, typename V>
+bool CuckooHashMap<K, V>::isEmpty() const
+{
+    return size == 0;
+}
+
+template class CuckooHashMap<unsigned int, unsigned int>;
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <iostream>
+#include <algorithm>
+#include <vector>
+#include <coroutine>
+#include <assert.h>
+
+#include "coroutine.hpp"
+#include "utils/profiler.cpp"
+#include "numa/numa_memory_resource.hpp"
+
+constexpr size_t CUCKOO_BUCKET_SIZE = 64;
+
+template <typename K, typename V>
+struct alignas(CUCKOO_BUCKET_SIZE) CuckooBucket
+{
+    static constexpr size_t SLOTS = std::max(size_t{1}, (CUCKOO_BUCKET_SIZE - sizeof(uint8_t)) / (sizeof(K) + sizeof(V)));
+
+    K keys[SLOTS];
+    V values[SLOTS];
+    uint8_t count = 0;
+};
+
+/*
+    Bucketized cuckoo hashing: every key lives in one of exactly two cache line sized buckets. A lookup
+    prefetches both candidate buckets at once, so it never waits for more than two independent misses. Inserts
+    into two full buckets evict a random key into its alternative bucket until a free slot is found.
+*/
+template <typename K, typename V>
+class CuckooHashMap
+{
+private:
+    static constexpr size_t MAX_EVICTIONS = 500;
+
+    std::pmr::vector<CuckooBucket<K, V>> table;
+    size_t size;
+    size_t capacity;
+    std::pmr::memory_resource &memory_resource;
+    uint64_t eviction_seed = 0x2545F4914F6CDD1Dull;
+
+    struct Candidates
+    {
+        size_t first;
+        size_t second;
+    };
+
+    Candidates candidates(const K &key);
+    size_t alternative(const K &key, size_t bucket);
+    // Scans both candidate buckets. A miss throws if found is nullptr, otherwise it is reported in found.
+    bool lookup(const K &key, const Candidates &buckets, std::vector<V> &results, std::vector<bool> *found, size_t i);
+
+    coroutine lookup_co(const K &key, std::vector<V> &results, std::vector<bool> *found, int i);
+    coroutine lookup_co_exp(const K &key, std::vector<V> &results, std::vector<bool> *found, int i);
+    void lookup_gp(const std::vector<K> &keys, std::vector<V> &results, std::vector<bool> *found);
+    void lookup_amac(const std::vector<K> &keys, std::vector<V> &results, std::vector<bool> *found, int group_size);
+    template <typename Coroutine>
+    void lookup_coroutine(const std::vector<K> &keys, std::vector<V> &results, std::vector<bool> *found, int group_size, Coroutine coroutine);
+
+    struct AMAC_state
+    {
+        K key;
+        Candidates buckets;
+        int stage = 0;
+        int i;
+    };
+
+public:
+    PrefetchProfiler &profiler;
+
+    // Capacity is the number of buckets.
+    CuckooHashMap(size_t capacity, PrefetchProfiler &profiler, std::pmr::memory_resource &memory_resource);
+    ~CuckooHashMap();
+    void insert(const K &key, const V &value);
+    V &get(const K &key);
+    void vectorized_get(const std::vector<K> &keys, std::vector<V> &results);
+    void vectorized_get_gp(const std::vector<K> &keys, std::vector<V> &results);
+    void vectorized_get_amac(const std::vector<K> &keys, std::vector<V> &results, int group_size);
+    void vectorized_get_coroutine(const std::vector<K> &keys, std::vector<V> &results, int group_size);
+    void vectorized_get_coroutine_exp(const std::vector<K> &keys, std::vector<V> &results, int group_size);
+    // Same as the get variants but a missing key is reported in found instead of throwing.
+    size_t vectorized_find(const std::vector<K> &keys, std::vector<V> &results, std::vector<bool> &found);
+    size_t vectorized_find_gp(const std::vector<K> &keys, std::vector<V> &results, std::vector<bool> &found);
+    size_t vectorized_find_amac(const std::vector<K> &keys, std::vector<V> &results, std::vector<bool> &found, int group_size);
+    size_t vectorized_find_coroutine(const std::vector<K> &keys, std::vector<V> &results, std::vector<bool> &found, int group_size);
+    size_t vectorized_find_coroutine_exp(const std::vector<K> &keys, std::vector<V> &results, std::vector<bool> &found, int group_size);
+    void remove(const K &key);
+    bool contains(const K &key);
+    size_t getSize() const;
+    bool isEmpty() const;
+
+    // Number of buckets required to hold num_keys keys at the given fill factor.
+    static size_t buckets_for(size_t num_keys, double fill_factor = 0.9);
+};
@@ -0,0 +1,228 @@
+#include <stdexcept>
+#include <algorithm>
+#include <cstdint>
+
+#include "executor.hpp"
+#include "prefetching.hpp"
+#include "utils.cpp"
+
+namespace
+{
+    uint64_t pack_chunks(uint64_t begin, uint64_t end)
+    {
+        return (begin << 32) | end;
+    }
+}
+
+WorkStealingExecutor::WorkStealingExecutor(const std::vector<NodeID> &nodes, size_t workers_per_node, size_t chunk_size) : chunk_size(std::max(size_t{1}, chunk_size))
+{
+    if (nodes.empty() || workers_per_node == 0)
+    {
+        throw std::invalid_argument("WorkStealingExecutor requires at least one NUMA node and worker.");
+    }
+
+    auto &manager = Prefetching::get().numa_manager;
+    for (auto node : nodes)
+    {
+        auto &cpus = manager.node_to_available_cpus[node];
+        if (cpus.empty())
+        {
+            throw std::invalid_argument("WorkStealingExecutor requires available CPUs on node " + std::to_string(node) + ".");
+        }
+        for (size_t w = 0; w < workers_per_node; ++w)
+        {
+            auto worker = std::make_unique<Worker>();
+            worker->node = node;
+            worker->cpu = cpus[w % cpus.size()];
+            workers.push_back(std::move(worker));
+        }
+    }
+
+    // Victims in rotating order starting after the worker itself, the siblings on the same node first.
+    for (size_t w = 0; w < workers.size(); ++w)
+    {
+        for (bool same_node : {true, false})
+        {
+            for (size_t offset = 1; offset < workers.size(); ++offset)
+            {
+                size_t victim = (w + offset) % workers.size();
+                if ((workers[victim]->node == workers[w]->node) == same_node)
+                {
+                    workers[w]->victims.push_back(victim);
+                }
+            }
+        }
+    }
+
+    for (auto &worker : workers)
+    {
+        worker->thread = std::jthread([this, worker = worker.get()]()
+                                      { worker_loop(*worker); });
+    }
+}
+
+WorkStealingExecutor::~WorkStealingExecutor()
+{
+    stop = true;
+    for (auto &worker : workers)
+    {
+        worker->sequence.fetch_add(1, std::memory_order_release);
+        worker->sequence.notify_one();
+    }
+    for (auto &worker : workers)
+    {
+        if (worker->thread.joinable())
+        {
+            worker->thread.join();
+        }
+    }
+}
+
+bool WorkStealingExecutor::take_chunk(Worker &worker, size_t &chunk)
+{
+    auto chunks = worker.chunks.load(std::memory_order_acquire);
+    while (true)
+    {
+        uint64_t begin = chunks >> 32;
+        uint64_t end = chunks & UINT32_MAX;
+        if (begin >= end)
+        {
+            return false;
+        }
+        if (worker.chunks.compare_exchange_weak(chunks, pack_chunks(begin + 1, end), std::memory_order_acq_rel))
+        {
+            chunk = begin;
+            return true;
+        }
+    }
+}
+
+bool WorkStealingExecutor::steal_chunks(Worker &worker)
+{
+    for (auto v : worker.victims)
+    {
+        auto &victim = *workers[v];
+        auto chunks = victim.chunks.load(std::memory_order_acquire);
+        while (true)
+        {
+            uint64_t begin = chunks >> 32;
+            uint64_t end = chunks & UINT32_MAX;
+            if (begin >= end)
+            {
+                break;
+            }
+            uint64_t middle = begin + (end - begin) / 2;
+            if (victim.chunks.compare_exchange_weak(chunks, pack_chunks(begin, middle), std::memory_order_acq_rel))
+            {
+                // The own range is empty, thieves leave it alone until it is refilled here.
+                worker.chunks.store(pack_chunks(middle, end), std::memory_order_release);
+                worker.stolen += end - middle;
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+void WorkStealingExecutor::worker_loop(Worker &worker)
+{
+    pin_to_cpu(worker.cpu);
+    uint64_t seen = 0;
+    while (true)
+    {
+        worker.sequence.wait(seen, std::memory_order_acquire);
+        seen = worker.sequence.load(std::memory_order_acquire);
+        if (stop)
+        {
+            return;
+        }
+
+        try
+        {
+            // A stolen range can be drained by other thieves before its first chunk is taken here, so the worker
+            // only stops once no victim has chunks left.
+            size_t chunk;
+            while (true)
+            {
+                if (take_chunk(worker, chunk))
+                {
+                    size_t begin = chunk * chunk_size;
+                    chunk_function(begin, std::min(begin + chunk_size, batch_size));
+                }
+                else if (!steal_chunks(worker))
+                {
+                    break;
+                }
+            }
+        }
+        catch (...)
+        {
+            // The batch fails, the remaining chunks of this worker only run if a sibling steals them.
+            worker.exception = std::current_exception();
+        }
+
+        if (pending_workers.fetch_sub(1, std::memory_order_acq_rel) == 1)
+        {
+            pending_workers.notify_all();
+        }
+    }
+}
+
+void WorkStealingExecutor::dispatch(size_t num_inputs, ChunkFunction function)
+{
+    if (num_inputs == 0)
+    {
+        return;
+    }
+    size_t num_chunks = (num_inputs + chunk_size - 1) / chunk_size;
+    if (num_chunks > UINT32_MAX)
+    {
+        throw std::length_error("WorkStealingExecutor supports batches of less than 2^32 chunks.");
+    }
+
+    for (size_t w = 0; w < workers.size(); ++w)
+    {
+        auto &worker = *workers[w];
+        worker.chunks.store(pack_chunks(w * num_chunks / workers.size(), (w + 1) * num_chunks / workers.size()), std::memory_order_relaxed);
+        worker.stolen = 0;
+        worker.exception = nullptr;
+    }
+
+    chunk_function = std::move(function);
+    batch_size = num_inputs;
+    pending_workers.store(workers.size(), std::memory_order_release);
+    for (auto &worker : workers)
+    {
+        worker->sequence.fetch_add(1, std::memory_order_release);
+        worker->sequence.notify_one();
+    }
+
+    size_t pending;
+    while ((pending = pending_workers.load(std::memory_order_acquire)) != 0)
+    {
+        pending_workers.wait(pending, std::memory_order_acquire);
+    }
+
+    for (auto &worker : workers)
+    {
+        if (worker->exception)
+        {
+            std::rethrow_exception(worker->exception);
+        }
+    }
+}
+
+size_t WorkStealingExecutor::num_workers() const
+{
+    return workers.size();
+}
+
+size_t WorkStealingExecutor::stolen_chunks() const
+{
+    size_t stolen = 0;
+    for (auto &worker : workers)
+    {
+        stolen += worker->stolen;
+    }
+    return stolen;
+}
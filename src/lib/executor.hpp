@@ -0,0 +1,74 @@
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <thread>
+#include <atomic>
+#include <functional>
+#include <exception>
+
+#include "interleave.hpp"
+#include "types.hpp"
+
+/*
+    Pool of worker threads, each pinned to a CPU of one of the given NUMA nodes (NumaManager). A batch of lookup
+    coroutines is cut into chunks of chunk_size lookups and every worker starts with a contiguous range of the
+    chunks, which it runs through its own interleaving group. A worker that runs out of chunks steals the back half
+    of the remaining range of a sibling, siblings on its own NUMA node first, so a single large batch keeps all
+    cores of a socket busy even if some chunks take longer than others (skew, remote memory, SMT siblings).
+
+    Coroutines never move between workers, every frame is created and destroyed on the thread (and frame pool) of
+    the worker that runs it. An executor runs one batch at a time.
+*/
+class WorkStealingExecutor
+{
+public:
+    WorkStealingExecutor(const std::vector<NodeID> &nodes, size_t workers_per_node, size_t chunk_size = 4096);
+    ~WorkStealingExecutor();
+
+    // Runs the coroutines factory(0), ..., factory(num_inputs - 1) on the workers, group_size of them interleaved
+    // per worker, and returns when all of them are done. factory is called concurrently by the workers.
+    template <typename Policy = RoundRobin, typename Factory>
+    void run(size_t num_inputs, size_t group_size, Factory factory);
+
+    size_t num_workers() const;
+    // Number of chunks that were stolen during the last batch.
+    size_t stolen_chunks() const;
+
+private:
+    using ChunkFunction = std::function<void(size_t, size_t)>;
+
+    struct alignas(64) Worker
+    {
+        NodeID node;
+        NodeID cpu;
+        std::vector<size_t> victims; // workers of the same node first
+        std::atomic<uint64_t> chunks{0}; // first chunk in the upper, end chunk in the lower 32 bits
+        size_t stolen = 0;
+        std::exception_ptr exception;
+        std::atomic<uint64_t> sequence{0};
+        std::jthread thread;
+    };
+
+    std::vector<std::unique_ptr<Worker>> workers;
+    size_t chunk_size;
+
+    // Shared with the workers for the batch in flight.
+    ChunkFunction chunk_function;
+    size_t batch_size = 0;
+    std::atomic<size_t> pending_workers{0};
+    std::atomic<bool> stop{false};
+
+    bool take_chunk(Worker &worker, size_t &chunk);
+    bool steal_chunks(Worker &worker);
+    void worker_loop(Worker &worker);
+    void dispatch(size_t num_inputs, ChunkFunction function);
+};
+
+template <typename Policy, typename Factory>
+void WorkStealingExecutor::run(size_t num_inputs, size_t group_size, Factory factory)
+{
+    dispatch(num_inputs, [&](size_t begin, size_t end)
+             { interleave<Policy>(end - begin, group_size, [&](size_t i)
+                                  { return factory(begin + i); }); });
+}
@@ -0,0 +1,228 @@
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <thread>
+#include <limits>
+#include <string>
+#include <type_traits>
+#include <exception>
+#include <stdexcept>
+
+#include "hashmap.hpp"
+#include "prefetching.hpp"
+#include "numa/static_numa_memory_resource.hpp"
+
+// COUNT, SUM, MIN and MAX of one group. Partial aggregates of the same group are combined with +=.
+template <typename V>
+struct Aggregate
+{
+    using Sum = std::conditional_t<std::is_floating_point_v<V>, double, std::conditional_t<std::is_signed_v<V>, int64_t, uint64_t>>;
+
+    uint64_t count = 0;
+    Sum sum = 0;
+    V min = std::numeric_limits<V>::max();
+    V max = std::numeric_limits<V>::lowest();
+
+    static Aggregate of(const V &value) { return {1, static_cast<Sum>(value), value, value}; }
+
+    Aggregate &operator+=(const Aggregate &other)
+    {
+        count += other.count;
+        sum += other.sum;
+        min = std::min(min, other.min);
+        max = std::max(max, other.max);
+        return *this;
+    }
+};
+
+enum class AggregationTechnique
+{
+    Plain,
+    AMAC,
+    Coroutine
+};
+
+inline AggregationTechnique parse_aggregation_technique(const std::string &name)
+{
+    if (name == "plain")
+    {
+        return AggregationTechnique::Plain;
+    }
+    else if (name == "amac")
+    {
+        return AggregationTechnique::AMAC;
+    }
+    else if (name == "coroutine")
+    {
+        return AggregationTechnique::Coroutine;
+    }
+    throw std::invalid_argument("Unknown aggregation technique: " + name);
+}
+
+/*
+    Hash group-by of a value column by a key column. The rows are split into one contiguous range per thread, every
+    thread is pinned to a CPU (round robin over the active NUMA nodes) and aggregates its range into a partial
+    HashMap placed on its own node. The find-or-insert-then-update sequence of a batch runs interleaved through the
+    HashMap merge operations. At the end, the partial tables are merged into the first one.
+*/
+template <typename K, typename V, typename Hash = StdHash, typename Index = ModuloIndex>
+class HashAggregation
+{
+public:
+    using Group = std::pair<K, Aggregate<V>>;
+
+private:
+    using Map = HashMap<K, Aggregate<V>, Hash, Index>;
+
+    struct Partial
+    {
+        NodeID node;
+        NodeID cpu;
+        std::unique_ptr<StaticNumaMemoryResource> memory_resource;
+        std::unique_ptr<Map> table;
+        std::exception_ptr exception;
+    };
+
+    size_t capacity;
+    PrefetchProfiler &profiler;
+    std::vector<Partial> partials;
+
+    static void merge_batch(Map &table, const std::vector<K> &keys, const std::vector<Aggregate<V>> &aggregates, AggregationTechnique technique, int group_size);
+
+public:
+    // Capacity is the initial number of buckets of every partial table, they grow with the number of groups.
+    HashAggregation(size_t num_threads, size_t capacity, PrefetchProfiler &profiler);
+    std::vector<Group> aggregate(const std::vector<K> &keys, const std::vector<V> &values, AggregationTechnique technique, int group_size, size_t batch_size = 1024);
+    size_t num_threads() const;
+};
+
+template <typename K, typename V, typename Hash, typename Index>
+HashAggregation<K, V, Hash, Index>::HashAggregation(size_t num_threads, size_t capacity, PrefetchProfiler &profiler) : capacity(std::max<size_t>(capacity, 1)), profiler(profiler), partials(num_threads)
+{
+    auto &manager = Prefetching::get().numa_manager;
+    auto &nodes = manager.active_nodes;
+    if (nodes.empty() || num_threads == 0)
+    {
+        throw std::invalid_argument("HashAggregation requires at least one active NUMA node and thread.");
+    }
+    for (size_t t = 0; t < num_threads; ++t)
+    {
+        auto &partial = partials[t];
+        partial.node = nodes[t % nodes.size()];
+        auto &cpus = manager.node_to_available_cpus[partial.node];
+        partial.cpu = cpus[(t / nodes.size()) % cpus.size()];
+    }
+}
+
+template <typename K, typename V, typename Hash, typename Index>
+void HashAggregation<K, V, Hash, Index>::merge_batch(Map &table, const std::vector<K> &keys, const std::vector<Aggregate<V>> &aggregates, AggregationTechnique technique, int group_size)
+{
+    switch (technique)
+    {
+    case AggregationTechnique::Plain:
+        for (size_t i = 0; i < keys.size(); ++i)
+        {
+            table.merge(keys[i], aggregates[i]);
+        }
+        break;
+    case AggregationTechnique::AMAC:
+        table.vectorized_merge_amac(keys, aggregates, group_size);
+        break;
+    case AggregationTechnique::Coroutine:
+        table.vectorized_merge_coroutine(keys, aggregates, group_size);
+        break;
+    }
+}
+
+template <typename K, typename V, typename Hash, typename Index>
+std::vector<typename HashAggregation<K, V, Hash, Index>::Group> HashAggregation<K, V, Hash, Index>::aggregate(const std::vector<K> &keys, const std::vector<V> &values, AggregationTechnique technique, int group_size, size_t batch_size)
+{
+    if (keys.size() != values.size())
+    {
+        throw std::invalid_argument("Key and value columns differ in length.");
+    }
+
+    size_t rows_per_thread = (keys.size() + partials.size() - 1) / partials.size();
+    {
+        std::vector<std::jthread> threads;
+        for (size_t t = 0; t < partials.size(); ++t)
+        {
+            threads.emplace_back([&, t]()
+                                 {
+                auto &partial = partials[t];
+                partial.exception = nullptr;
+                partial.table.reset();
+                try
+                {
+                    pin_to_cpu(partial.cpu);
+                    partial.memory_resource = std::make_unique<StaticNumaMemoryResource>(partial.node);
+                    partial.table = std::make_unique<Map>(capacity, profiler, *partial.memory_resource);
+
+                    size_t begin = std::min(t * rows_per_thread, keys.size());
+                    size_t end = std::min(begin + rows_per_thread, keys.size());
+                    std::vector<K> batch_keys;
+                    std::vector<Aggregate<V>> batch_aggregates;
+                    for (size_t offset = begin; offset < end; offset += batch_size)
+                    {
+                        size_t batch_end = std::min(offset + batch_size, end);
+                        batch_keys.assign(keys.begin() + offset, keys.begin() + batch_end);
+                        batch_aggregates.clear();
+                        for (size_t row = offset; row < batch_end; ++row)
+                        {
+                            batch_aggregates.push_back(Aggregate<V>::of(values[row]));
+                        }
+                        merge_batch(*partial.table, batch_keys, batch_aggregates, technique, group_size);
+                    }
+                }
+                catch (...)
+                {
+                    partial.exception = std::current_exception();
+                } });
+        }
+    }
+    for (auto &partial : partials)
+    {
+        if (partial.exception)
+        {
+            std::rethrow_exception(partial.exception);
+        }
+    }
+
+    auto &result = *partials[0].table;
+    std::vector<K> batch_keys;
+    std::vector<Aggregate<V>> batch_aggregates;
+    for (size_t t = 1; t < partials.size(); ++t)
+    {
+        partials[t].table->for_each([&](const K &key, const Aggregate<V> &aggregate)
+                                    {
+                                        batch_keys.push_back(key);
+                                        batch_aggregates.push_back(aggregate);
+                                        if (batch_keys.size() == batch_size)
+                                        {
+                                            merge_batch(result, batch_keys, batch_aggregates, technique, group_size);
+                                            batch_keys.clear();
+                                            batch_aggregates.clear();
+                                        } });
+    }
+    merge_batch(result, batch_keys, batch_aggregates, technique, group_size);
+
+    std::vector<Group> groups;
+    groups.reserve(result.getSize());
+    result.for_each([&](const K &key, const Aggregate<V> &aggregate)
+                    { groups.emplace_back(key, aggregate); });
+
+    // Release the partial tables, tables have to go before their memory resources.
+    for (auto &partial : partials)
+    {
+        partial.table.reset();
+        partial.memory_resource.reset();
+    }
+    return groups;
+}
+
+template <typename K, typename V, typename Hash, typename Index>
+size_t HashAggregation<K, V, Hash, Index>::num_threads() const
+{
+    return partials.size();
+}
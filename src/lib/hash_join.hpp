@@ -0,0 +1,125 @@
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <stdexcept>
+
+#include "hashmap.hpp"
+#include "technique.hpp"
+
+// Row ids of the matching pairs, stored column wise.
+struct JoinResult
+{
+    std::vector<uint32_t> build_rows;
+    std::vector<uint32_t> probe_rows;
+
+    size_t size() const { return build_rows.size(); }
+};
+
+/*
+    Equi-join of two key columns, row ids are the positions within the columns. The build side is loaded into a
+    HashMap from each distinct key to its last build row, earlier rows with the same key are linked through
+    next_row. The probe side is looked up in batches with the non-throwing find variant of the chosen technique.
+*/
+template <typename K, typename Hash = StdHash, typename Index = ModuloIndex>
+class HashJoin
+{
+private:
+    static constexpr uint32_t NO_ROW = UINT32_MAX;
+
+    PrefetchProfiler &profiler;
+    std::pmr::memory_resource &memory_resource;
+    std::unique_ptr<HashMap<K, uint32_t, Hash, Index>> table;
+    std::vector<uint32_t> next_row;
+    TechniqueBuffers<K, uint32_t> buffers;
+
+public:
+    HashJoin(PrefetchProfiler &profiler, std::pmr::memory_resource &memory_resource);
+    void build(const std::vector<K> &keys);
+    // GP probes group_size keys per batch, it prefetches a whole batch at once. The other techniques probe
+    // batch_size keys per batch with group_size lookups in flight.
+    JoinResult probe(const std::vector<K> &keys, Technique technique, int group_size, size_t batch_size = 1024);
+    size_t build_size() const;
+    size_t distinct_keys() const;
+};
+
+template <typename K, typename Hash, typename Index>
+HashJoin<K, Hash, Index>::HashJoin(PrefetchProfiler &profiler, std::pmr::memory_resource &memory_resource) : profiler(profiler), memory_resource(memory_resource)
+{
+}
+
+template <typename K, typename Hash, typename Index>
+void HashJoin<K, Hash, Index>::build(const std::vector<K> &keys)
+{
+    if (keys.size() >= NO_ROW)
+    {
+        throw std::length_error("HashJoin supports less than 2^32 - 1 build rows.");
+    }
+    table = std::make_unique<HashMap<K, uint32_t, Hash, Index>>(std::max<size_t>(keys.size(), 1), profiler, memory_resource, 0);
+    next_row.assign(keys.size(), NO_ROW);
+    for (uint32_t row = 0; row < keys.size(); ++row)
+    {
+        if (table->contains(keys[row]))
+        {
+            uint32_t &head = table->get(keys[row]);
+            next_row[row] = head;
+            head = row;
+        }
+        else
+        {
+            table->insert(keys[row], row);
+        }
+    }
+}
+
+template <typename K, typename Hash, typename Index>
+JoinResult HashJoin<K, Hash, Index>::probe(const std::vector<K> &keys, Technique technique, int group_size, size_t batch_size)
+{
+    if (!table)
+    {
+        throw std::logic_error("HashJoin has to be built before probing.");
+    }
+    if (technique == Technique::GP)
+    {
+        batch_size = group_size;
+    }
+
+    JoinResult result;
+    std::vector<K> batch;
+    std::vector<uint32_t> heads(batch_size);
+    std::vector<bool> found(batch_size);
+    for (size_t offset = 0; offset < keys.size(); offset += batch_size)
+    {
+        size_t end = std::min(offset + batch_size, keys.size());
+        batch.assign(keys.begin() + offset, keys.begin() + end);
+        heads.resize(batch.size());
+        found.resize(batch.size());
+        run_technique(*table, technique, batch, heads, found, group_size, buffers);
+
+        for (size_t i = 0; i < batch.size(); ++i)
+        {
+            if (!found[i])
+            {
+                continue;
+            }
+            for (uint32_t row = heads[i]; row != NO_ROW; row = next_row[row])
+            {
+                result.build_rows.push_back(row);
+                result.probe_rows.push_back(offset + i);
+            }
+        }
+    }
+    return result;
+}
+
+template <typename K, typename Hash, typename Index>
+size_t HashJoin<K, Hash, Index>::build_size() const
+{
+    return next_row.size();
+}
+
+template <typename K, typename Hash, typename Index>
+size_t HashJoin<K, Hash, Index>::distinct_keys() const
+{
+    return table ? table->getSize() : 0;
+}
@@ -0,0 +1,137 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <type_traits>
+#if defined(X86_64)
+#include <nmmintrin.h>
+#elif defined(AARCH64) && defined(__ARM_FEATURE_CRC32)
+#include <arm_acle.h>
+#endif
+
+#include "utils/utils.cpp"
+
+/*
+    Hash policies turn a key into a hash value, index policies reduce that hash value to a bucket index.
+    Integral keys are hashed directly, all other keys are first folded to 64 bits by std::hash.
+*/
+template <typename K>
+inline uint64_t key_bits(const K &key)
+{
+    if constexpr (std::is_integral_v<K>)
+    {
+        return static_cast<uint64_t>(key);
+    }
+    else
+    {
+        return std::hash<K>{}(key);
+    }
+}
+
+// The identity for integers, as std::unordered_map does it.
+struct StdHash
+{
+    template <typename K>
+    size_t operator()(const K &key) const
+    {
+        return std::hash<K>{}(key);
+    }
+};
+
+struct MurmurHash
+{
+    template <typename K>
+    size_t operator()(const K &key) const
+    {
+        uint64_t bits = key_bits(key);
+        return murmur_32(static_cast<uint32_t>(bits ^ (bits >> 32)));
+    }
+};
+
+#if defined(X86_64) && !defined(__SSE4_2__)
+__attribute__((target("sse4.2"))) inline uint32_t crc32_sse42(uint64_t bits)
+{
+    return _mm_crc32_u64(0, bits);
+}
+
+template <typename KeyAt>
+__attribute__((target("sse4.2"))) void crc32_batch_sse42(size_t num_keys, KeyAt key_at, size_t *hashes)
+{
+    for (size_t i = 0; i < num_keys; ++i)
+    {
+        hashes[i] = _mm_crc32_u64(0, key_bits(key_at(i)));
+    }
+}
+#endif
+
+// CRC32-C, one instruction on x86 with SSE4.2 and on ARMv8 with the CRC extension. Builds without -msse4.2 check
+// for SSE4.2 at runtime, per key and once per batch in hash_batch.
+struct Crc32Hash
+{
+    template <typename K>
+    size_t operator()(const K &key) const
+    {
+        uint64_t bits = key_bits(key);
+#if defined(X86_64) && defined(__SSE4_2__)
+        return _mm_crc32_u64(0, bits);
+#elif defined(AARCH64) && defined(__ARM_FEATURE_CRC32)
+        return __crc32cd(0, bits);
+#else
+#if defined(X86_64)
+        if (__builtin_cpu_supports("sse4.2"))
+        {
+            return crc32_sse42(bits);
+        }
+#endif
+        uint32_t crc = 0;
+        for (int i = 0; i < 64; ++i)
+        {
+            uint32_t bit = (crc ^ (bits >> i)) & 1;
+            crc = (crc >> 1) ^ (0x82F63B78 & -bit);
+        }
+        return crc;
+#endif
+    }
+
+    // Hashes key_at(0), ..., key_at(num_keys - 1) into hashes.
+    template <typename KeyAt>
+    static void hash_batch(size_t num_keys, KeyAt key_at, size_t *hashes)
+    {
+#if defined(X86_64) && !defined(__SSE4_2__)
+        if (__builtin_cpu_supports("sse4.2"))
+        {
+            crc32_batch_sse42(num_keys, key_at, hashes);
+            return;
+        }
+#endif
+        for (size_t i = 0; i < num_keys; ++i)
+        {
+            hashes[i] = Crc32Hash{}(key_at(i));
+        }
+    }
+};
+
+// Keeps the upper half of the product, its bits are the ones that depend on all bits of the key.
+struct MultiplyShiftHash
+{
+    template <typename K>
+    size_t operator()(const K &key) const
+    {
+        return (key_bits(key) * 0x9E3779B97F4A7C15ull) >> 32;
+    }
+};
+
+struct ModuloIndex
+{
+    static constexpr bool power_of_two = false;
+
+    static size_t index(size_t hash, size_t capacity) { return hash % capacity; }
+};
+
+// Requires a power of two capacity, replaces the division by a mask.
+struct MaskIndex
+{
+    static constexpr bool power_of_two = true;
+
+    static size_t index(size_t hash, size_t capacity) { return hash & (capacity - 1); }
+};
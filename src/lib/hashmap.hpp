@@ -1,13 +1,26 @@
+#pragma once
+
 #include <iostream>
+#include <algorithm>
+#include <bit>
+#include <string>
+#include <stdexcept>
 #include <list>
 #include <vector>
 #include <coroutine>
 #include <iterator>
+#include <atomic>
 #include <assert.h>
 
 #include "coroutine.hpp"
 #include "utils/profiler.cpp"
+#include "utils/utils.cpp"
+#include "interleave.hpp"
+#include "prefetch.hpp"
+#include "executor.hpp"
+#include "hash_policy.hpp"
 #include "numa/numa_memory_resource.hpp"
+#include "numa/slab_memory_resource.hpp"
 
 using namespace std;
 
@@ -19,42 +32,1325 @@ public:
     V value;
 };
 
-template<typename K, typename V>
+/*
+    Keys of fixed size are compared straight from the node. Variable-length keys may keep their bytes outside of
+    the node, those have to be prefetched as well before a stored key can be compared with a probe key.
+*/
+template <typename K>
+struct KeyTraits
+{
+    static const void *out_of_line_bytes(const K &stored, const K &probe) { return nullptr; }
+};
+
+template <typename CharT, typename Traits, typename Allocator>
+struct KeyTraits<std::basic_string<CharT, Traits, Allocator>>
+{
+    // Nothing to load if the lengths differ already or the string is short enough to be stored inline.
+    static const void *out_of_line_bytes(const std::basic_string<CharT, Traits, Allocator> &stored, const std::basic_string<CharT, Traits, Allocator> &probe)
+    {
+        auto *bytes = reinterpret_cast<const char *>(stored.data());
+        auto *object = reinterpret_cast<const char *>(&stored);
+        if (stored.size() != probe.size() || (bytes >= object && bytes < object + sizeof(stored)))
+        {
+            return nullptr;
+        }
+        return bytes;
+    }
+};
+
+enum class OperationType : uint8_t
+{
+    Insert, // insert if the key is absent, keep the stored value otherwise
+    Upsert, // insert or overwrite
+    Remove,
+    Merge // insert if the key is absent, add the value to the stored one otherwise
+};
+
+// Merging adds with operator+=, aggregate values define it to combine two partial aggregates.
+template <typename V>
+concept Mergeable = requires(V &stored, const V &value) { stored += value; };
+
+template <Mergeable V>
+inline void merge_value(V &stored, const V &value)
+{
+    stored += value;
+}
+
+template <typename K, typename V>
+struct Operation
+{
+    OperationType type;
+    K key;
+    V value;
+};
+
+/*
+    The table grows by doubling, as often as needed to get back under max_load_factor, once the load factor exceeds
+    it. Growing only allocates the new table, the buckets of the old table are moved over incrementally: every write
+    operation splices the nodes of a few old buckets into the new table. Until the migration finished, a key lives
+    in its old bucket if that bucket was not migrated yet and in its new bucket otherwise. A growth that becomes due
+    while a migration is running waits for it, so no write pays for a whole migration at once. Batched writes run in
+    chunks that fit under the load factor and the table grows between the chunks. Lookups never migrate, so they
+    stay safe to run concurrently with each other.
+*/
+template <typename K, typename V, typename Hash = StdHash, typename Index = ModuloIndex>
 class HashMap {
 private:
-    std::pmr::vector<std::pmr::list<Node<K, V>>> table;
+    using Chain = std::pmr::list<Node<K, V>>;
+
+    static constexpr size_t MIGRATION_BUCKETS_PER_OPERATION = 4;
+    static constexpr size_t MIGRATION_PREFETCH_DISTANCE = 8;
+    static constexpr size_t MIN_WRITE_CHUNK = 1024;
+
+    std::pmr::vector<Chain> table;
     size_t size;
     size_t capacity;
     std::pmr::memory_resource &memory_resource;
+    double max_load_factor;
+
+    // Table that is being migrated, old buckets [0, migrated) are empty already.
+    std::pmr::vector<Chain> old_table;
+    size_t old_capacity = 0;
+    size_t migrated = 0;
+
+    // Keys removed by the batched write in progress.
+    size_t batch_removed = 0;
 
     size_t hash(const K& key);
+    Chain &bucket_of(const K &key);
+    Chain &bucket_for(size_t hash);
+    // Hashes of a batch, in the buffer of the map or, while a concurrent or nested batch holds that buffer, in
+    // an own vector.
+    class HashBatch
+    {
+    public:
+        template <typename KeyAt>
+        HashBatch(HashMap &map, size_t num_keys, KeyAt key_at);
+        ~HashBatch();
+        HashBatch(const HashBatch &) = delete;
+        HashBatch &operator=(const HashBatch &) = delete;
+        size_t operator[](size_t i) const { return hashes[i]; }
+
+    private:
+        std::atomic<bool> *buffer_in_use = nullptr;
+        std::vector<size_t> own;
+        size_t *hashes;
+    };
+
+    std::vector<size_t> hash_buffer;
+    std::atomic<bool> hash_buffer_in_use{false};
+
+    // Hashes a whole batch in one tight loop before any bucket is touched.
+    template <typename KeyAt>
+    HashBatch hash_batch(size_t num_keys, KeyAt key_at);
+    HashBatch hash_batch(const std::vector<K> &keys);
+    void migrate(size_t num_buckets);
+    void grow_if_needed();
+    size_t write_chunk_size(size_t num_operations) const;
+    // Calls apply_chunk(begin, end) for consecutive chunks of the batch, with the migration work of a chunk done
+    // before it and a growth check after it.
+    template <typename ApplyChunk>
+    void apply_in_chunks(size_t num_operations, ApplyChunk apply_chunk);
 
     struct AMAC_state {
         K key;
+        Chain *bucket;
         typename std::list<Node<K, V>>::iterator node;
         typename std::list<Node<K, V>>::iterator end;
         int stage = 0;
         int i;
     };
 
+    struct AMAC_write_state {
+        Operation<K, V> operation;
+        Chain *bucket;
+        typename std::list<Node<K, V>>::iterator node;
+        typename std::list<Node<K, V>>::iterator end;
+        int stage = 0;
+    };
+
+    void apply_found(Chain &bucket, typename std::list<Node<K, V>>::iterator node, const Operation<K, V> &operation);
+    void apply_missing(Chain &bucket, const Operation<K, V> &operation);
+    coroutine apply_co(const Operation<K, V> operation, Chain &bucket);
+    void check_mergeable(const std::vector<Operation<K, V>> &operations) const;
+    template <typename OperationAt>
+    void apply_chunk_amac(size_t begin, size_t end, OperationAt operation_at, int group_size);
+    template <typename OperationAt>
+    void apply_chunk_coroutine(size_t begin, size_t end, OperationAt operation_at, int group_size);
+    // Return the number of removed keys.
+    template <typename OperationAt>
+    size_t vectorized_apply_amac(size_t num_operations, OperationAt operation_at, int group_size);
+    template <typename OperationAt>
+    size_t vectorized_apply_coroutine(size_t num_operations, OperationAt operation_at, int group_size);
+
 public:
     PrefetchProfiler &profiler;
 
-    HashMap(size_t capacity, PrefetchProfiler &profiler, std::pmr::memory_resource &memory_resource);
+    // Allocation size of a chain node including the two list links, the object size of a SlabMemoryResource
+    // that holds the nodes.
+    static constexpr size_t NODE_SIZE = sizeof(Node<K, V>) + 2 * sizeof(void *);
+
+    // A max_load_factor of 0 disables growing, the table then keeps its initial capacity.
+    HashMap(size_t capacity, PrefetchProfiler &profiler, std::pmr::memory_resource &memory_resource, double max_load_factor = 1.0);
     ~HashMap();
     void insert(const K& key, const V& value);
+    void merge(const K &key, const V &value)
+        requires Mergeable<V>;
     V& get(const K& key);
-    coroutine get_co(const K& key, std::vector<V>& results, int i);
-    coroutine get_co_exp(const K &key, std::vector<V> &results, int i);
-    coroutine profile_get_co_exp(const K &key, std::vector<V> &results, int i);
+    coroutine get_co(const K& key, size_t key_hash, std::vector<V>& results, int i);
+    coroutine get_co_exp(const K &key, size_t key_hash, std::vector<V> &results, int i);
+    coroutine profile_get_co_exp(const K &key, size_t key_hash, std::vector<V> &results, int i);
     void vectorized_get(const std::vector<K>& keys, std::vector<V>& results);
     void vectorized_get_gp(const std::vector<K>& keys, std::vector<V>& results);
     void vectorized_get_amac(const std::vector<K>& keys, std::vector<V>& results, int group_size);
     void vectorized_get_coroutine(const std::vector<K>& keys, std::vector<V>& results, int group_size);
+    // Spreads the batch over the workers of executor, the keys are hashed by the workers.
+    void vectorized_get_coroutine(const std::vector<K> &keys, std::vector<V> &results, int group_size, WorkStealingExecutor &executor);
     void vectorized_get_coroutine_exp(const std::vector<K> &keys, std::vector<V> &results, int group_size);
     void profile_vectorized_get_coroutine_exp(const std::vector<K> &keys, std::vector<V> &results, int group_size);
+    // Lookups that do not throw on a miss. found[i] tells whether keys[i] is present, results[i] is only written
+    // for present keys. Empty buckets are answered as soon as the bucket is loaded, without touching a node.
+    // Return the number of present keys.
+    coroutine find_co(const K &key, size_t key_hash, std::vector<V> &results, std::vector<bool> &found, int i);
+    coroutine find_co_exp(const K &key, size_t key_hash, std::vector<V> &results, std::vector<bool> &found, int i);
+    size_t vectorized_find(const std::vector<K> &keys, std::vector<V> &results, std::vector<bool> &found);
+    size_t vectorized_find_gp(const std::vector<K> &keys, std::vector<V> &results, std::vector<bool> &found);
+    size_t vectorized_find_amac(const std::vector<K> &keys, std::vector<V> &results, std::vector<bool> &found, int group_size);
+    size_t vectorized_find_coroutine(const std::vector<K> &keys, std::vector<V> &results, std::vector<bool> &found, int group_size);
+    size_t vectorized_find_coroutine_exp(const std::vector<K> &keys, std::vector<V> &results, std::vector<bool> &found, int group_size);
     void remove(const K& key);
+    // Batched writes. Operations on the same bucket are never in flight at the same time, so they are applied in
+    // batch order. Unlike remove(), a batched remove of a missing key is skipped, both techniques apply the whole
+    // batch and the remove and mixed variants return the number of removed keys.
+    void vectorized_insert_amac(const std::vector<K> &keys, const std::vector<V> &values, int group_size);
+    void vectorized_insert_coroutine(const std::vector<K> &keys, const std::vector<V> &values, int group_size);
+    void vectorized_upsert_amac(const std::vector<K> &keys, const std::vector<V> &values, int group_size);
+    void vectorized_upsert_coroutine(const std::vector<K> &keys, const std::vector<V> &values, int group_size);
+    size_t vectorized_remove_amac(const std::vector<K> &keys, int group_size);
+    size_t vectorized_remove_coroutine(const std::vector<K> &keys, int group_size);
+    void vectorized_merge_amac(const std::vector<K> &keys, const std::vector<V> &values, int group_size)
+        requires Mergeable<V>;
+    void vectorized_merge_coroutine(const std::vector<K> &keys, const std::vector<V> &values, int group_size)
+        requires Mergeable<V>;
+    // Merge operations require a Mergeable V, mixed batches of other value types that contain one are rejected
+    // with invalid_argument before any operation is applied.
+    size_t vectorized_mixed_amac(const std::vector<Operation<K, V>> &operations, int group_size);
+    size_t vectorized_mixed_coroutine(const std::vector<Operation<K, V>> &operations, int group_size);
+    // Visits every entry, including the ones still waiting for their migration.
+    template <typename Function>
+    void for_each(Function function);
     bool contains(const K& key);
+    // Bucket a lookup of key loads first, used to sample the miss rate.
+    const void *address_of(const K &key);
     size_t getSize() const;
     bool isEmpty() const;
+    size_t bucket_count() const;
+    bool is_resizing() const;
+    // Finishes a pending migration and re-allocates all nodes bucket by bucket. On a SlabMemoryResource the nodes
+    // of a chain then lie back to back, in the order of the table.
+    void compact();
 };
+
+template <typename K, typename V, typename Hash, typename Index>
+size_t HashMap<K, V, Hash, Index>::hash(const K& key) {
+    return Index::index(Hash{}(key), capacity);
+}
+
+template <typename K, typename V, typename Hash, typename Index>
+typename HashMap<K, V, Hash, Index>::Chain &HashMap<K, V, Hash, Index>::bucket_of(const K &key)
+{
+    return bucket_for(Hash{}(key));
+}
+
+template <typename K, typename V, typename Hash, typename Index>
+typename HashMap<K, V, Hash, Index>::Chain &HashMap<K, V, Hash, Index>::bucket_for(size_t hash)
+{
+    if (migrated < old_capacity)
+    {
+        size_t old_index = Index::index(hash, old_capacity);
+        if (old_index >= migrated)
+        {
+            return old_table[old_index];
+        }
+    }
+    return table[Index::index(hash, capacity)];
+}
+
+template <typename K, typename V, typename Hash, typename Index>
+template <typename KeyAt>
+HashMap<K, V, Hash, Index>::HashBatch::HashBatch(HashMap &map, size_t num_keys, KeyAt key_at)
+{
+    if (!map.hash_buffer_in_use.exchange(true, std::memory_order_acquire))
+    {
+        buffer_in_use = &map.hash_buffer_in_use;
+        map.hash_buffer.resize(num_keys);
+        hashes = map.hash_buffer.data();
+    }
+    else
+    {
+        own.resize(num_keys);
+        hashes = own.data();
+    }
+
+    if constexpr (requires { Hash::hash_batch(num_keys, key_at, hashes); })
+    {
+        Hash::hash_batch(num_keys, key_at, hashes);
+    }
+    else
+    {
+        for (size_t i = 0; i < num_keys; ++i)
+        {
+            hashes[i] = Hash{}(key_at(i));
+        }
+    }
+}
+
+template <typename K, typename V, typename Hash, typename Index>
+HashMap<K, V, Hash, Index>::HashBatch::~HashBatch()
+{
+    if (buffer_in_use)
+    {
+        buffer_in_use->store(false, std::memory_order_release);
+    }
+}
+
+template <typename K, typename V, typename Hash, typename Index>
+template <typename KeyAt>
+typename HashMap<K, V, Hash, Index>::HashBatch HashMap<K, V, Hash, Index>::hash_batch(size_t num_keys, KeyAt key_at)
+{
+    return HashBatch(*this, num_keys, key_at);
+}
+
+template <typename K, typename V, typename Hash, typename Index>
+typename HashMap<K, V, Hash, Index>::HashBatch HashMap<K, V, Hash, Index>::hash_batch(const std::vector<K> &keys)
+{
+    return hash_batch(keys.size(), [&](size_t i) -> const K &
+                      { return keys[i]; });
+}
+
+template <typename K, typename V, typename Hash, typename Index>
+void HashMap<K, V, Hash, Index>::migrate(size_t num_buckets)
+{
+    if (migrated >= old_capacity)
+    {
+        return;
+    }
+
+    size_t end = std::min(old_capacity, migrated + num_buckets);
+    for (; migrated < end; ++migrated)
+    {
+        // The list head is needed before its first node can be prefetched, thus the heads run twice as far ahead.
+        if (migrated + 2 * MIGRATION_PREFETCH_DISTANCE < old_capacity)
+        {
+            prefetch_line<1>(&old_table[migrated + 2 * MIGRATION_PREFETCH_DISTANCE]);
+        }
+        if (migrated + MIGRATION_PREFETCH_DISTANCE < old_capacity && !old_table[migrated + MIGRATION_PREFETCH_DISTANCE].empty())
+        {
+            prefetch_line<1>(&old_table[migrated + MIGRATION_PREFETCH_DISTANCE].front());
+        }
+
+        // Both tables allocate from the same memory resource, so nodes are relinked instead of copied.
+        auto &source = old_table[migrated];
+        while (!source.empty())
+        {
+            auto &target = table[hash(source.front().key)];
+            target.splice(target.end(), source, source.begin());
+        }
+    }
+
+    if (migrated == old_capacity)
+    {
+        old_table.clear();
+        old_table.shrink_to_fit();
+        old_capacity = 0;
+        migrated = 0;
+    }
+}
+
+template <typename K, typename V, typename Hash, typename Index>
+void HashMap<K, V, Hash, Index>::grow_if_needed()
+{
+    if (max_load_factor <= 0 || size <= max_load_factor * capacity)
+    {
+        return;
+    }
+    // At most one old table is live at a time, the running migration is finished by the following writes.
+    if (old_capacity != 0)
+    {
+        return;
+    }
+
+    old_table.swap(table);
+    old_capacity = capacity;
+    migrated = 0;
+    while (size > max_load_factor * capacity)
+    {
+        capacity *= 2;
+    }
+    table.resize(capacity);
+}
+
+// The headroom until the next growth, at least MIN_WRITE_CHUNK operations.
+template <typename K, typename V, typename Hash, typename Index>
+size_t HashMap<K, V, Hash, Index>::write_chunk_size(size_t num_operations) const
+{
+    if (max_load_factor <= 0)
+    {
+        return num_operations;
+    }
+    double headroom = max_load_factor * capacity - size;
+    size_t chunk = headroom > MIN_WRITE_CHUNK ? static_cast<size_t>(headroom) : MIN_WRITE_CHUNK;
+    return std::min(chunk, num_operations);
+}
+
+template <typename K, typename V, typename Hash, typename Index>
+template <typename ApplyChunk>
+void HashMap<K, V, Hash, Index>::apply_in_chunks(size_t num_operations, ApplyChunk apply_chunk)
+{
+    size_t begin = 0;
+    while (begin < num_operations)
+    {
+        size_t end = begin + write_chunk_size(num_operations - begin);
+        // Buckets must not move while operations are in flight, so the migration work of the chunk is done upfront.
+        migrate((end - begin) * MIGRATION_BUCKETS_PER_OPERATION);
+        apply_chunk(begin, end);
+        grow_if_needed();
+        begin = end;
+    }
+}
+
+template <typename K, typename V, typename Hash, typename Index>
+HashMap<K, V, Hash, Index>::HashMap(size_t capacity, PrefetchProfiler &profiler, std::pmr::memory_resource &memory_resource, double max_load_factor) : capacity(Index::power_of_two ? std::bit_ceil(capacity) : capacity), size(0), profiler(profiler), memory_resource(memory_resource), max_load_factor(max_load_factor), table(&memory_resource), old_table(&memory_resource)
+{
+    // The polymorphic allocator constructs the lists on the table's memory resource.
+    table.resize(this->capacity);
+}
+
+template <typename K, typename V, typename Hash, typename Index>
+HashMap<K, V, Hash, Index>::~HashMap() {}
+
+template <typename K, typename V, typename Hash, typename Index>
+void HashMap<K, V, Hash, Index>::insert(const K& key, const V& value) {
+    migrate(MIGRATION_BUCKETS_PER_OPERATION);
+    auto& bucket = bucket_of(key);
+    for (auto& node : bucket) {
+        if (node.key == key) {
+            node.value = value;
+            return;
+        }
+    }
+    bucket.emplace_back(key, value);
+    size++;
+    grow_if_needed();
+}
+
+template <typename K, typename V, typename Hash, typename Index>
+void HashMap<K, V, Hash, Index>::merge(const K &key, const V &value)
+    requires Mergeable<V>
+{
+    migrate(MIGRATION_BUCKETS_PER_OPERATION);
+    auto &bucket = bucket_of(key);
+    for (auto &node : bucket)
+    {
+        if (node.key == key)
+        {
+            merge_value(node.value, value);
+            return;
+        }
+    }
+    bucket.emplace_back(key, value);
+    size++;
+    grow_if_needed();
+}
+
+template <typename K, typename V, typename Hash, typename Index>
+V& HashMap<K, V, Hash, Index>::get(const K& key) {
+    for (auto& node : bucket_of(key)) {
+        if (node.key == key) {
+            return node.value;
+        }
+    }
+    throw out_of_range("Key not found");
+}
+
+template <typename K, typename V, typename Hash, typename Index>
+void HashMap<K, V, Hash, Index>::vectorized_get(const std::vector<K>& keys, std::vector<V>& results) {
+    int i = 0;
+    for(auto &key : keys){
+        bool found = false;
+        for (auto& node : bucket_of(key)) {
+            if (node.key == key) {
+                results.at(i) = node.value;
+                found = true;
+                break;
+            }
+        }
+        if(!found){
+            throw out_of_range("Key not found");
+        }
+        i++;
+    }
+}
+
+template <typename K, typename V, typename Hash, typename Index>
+void HashMap<K, V, Hash, Index>::vectorized_get_gp(const std::vector<K>& keys, std::vector<V>& results) {
+    // Vector to keep track of states for each key
+    std::vector<int> states(keys.size(), -1);
+    // states:
+    // -1: Get first node
+    //  0: Prefetch next list node
+    //  1: Finished, element found
+    //  2: Out-of-line key bytes prefetched
+
+    std::vector<typename std::list<Node<K, V>>::iterator> nodes;
+    std::vector<Chain*> buckets(keys.size());
+
+    auto hashes = hash_batch(keys);
+    for (int i = 0; i < keys.size(); i++) {
+        buckets[i] = &bucket_for(hashes[i]);
+        __builtin_prefetch(buckets[i], 0, 3);
+    }
+
+    int finished = 0;
+    while (finished < keys.size()) {
+        for (int i = 0; i < keys.size(); i++) {
+            int& state = states[i];
+            if (state == -1) {
+                nodes.emplace_back(buckets[i]->begin());
+                __builtin_prefetch(&(*nodes.back()), 0, 3);
+                state = 0;
+            } else if (state == 0 || state == 2) {
+                auto& node = nodes[i];
+                if (state == 0) {
+                    if (auto* bytes = KeyTraits<K>::out_of_line_bytes(node->key, keys[i])) {
+                        __builtin_prefetch(bytes, 0, 3);
+                        state = 2;
+                        continue;
+                    }
+                }
+                if (node->key == keys[i]) {
+                    results[i] = node->value;
+                    state = 1;
+                    ++finished;
+                    continue;
+                }
+                ++node;
+                state = 0;
+                if (node != buckets[i]->end()) {
+                    __builtin_prefetch(reinterpret_cast<char *>(&(*node)), 0, 3);
+                } else {
+                    throw out_of_range("Key not found.");
+                }
+            } else {
+                // Finished processing this key
+                continue;
+            }
+        }
+    }
+}
+
+
+
+template <typename K, typename V, typename Hash, typename Index>
+void HashMap<K, V, Hash, Index>::vectorized_get_amac(const std::vector<K>& keys, std::vector<V>& results, int group_size) {
+    CircularBuffer<AMAC_state> buff(group_size);
+    auto hashes = hash_batch(keys);
+
+    // Initialize variables
+    int num_finished = 0;
+    int i = 0;
+    int j = 0;
+    while (num_finished < keys.size()) {
+        AMAC_state& state = buff.next_state();
+
+        if (state.stage == 0) {
+            if(i >= keys.size()){
+                continue;
+            }
+            state.i = i;
+            state.key = keys[i];
+            auto& bucket = bucket_for(hashes[i++]);
+            state.node = bucket.begin();
+            state.end = bucket.end();
+            state.stage = 1;
+            __builtin_prefetch(&(*state.node), 0, 3);
+        } else {
+            // stage 1: node prefetched, stage 2: out-of-line key bytes prefetched
+            if (state.stage == 1) {
+                if (auto* bytes = KeyTraits<K>::out_of_line_bytes(state.node->key, state.key)) {
+                    __builtin_prefetch(bytes, 0, 3);
+                    state.stage = 2;
+                    continue;
+                }
+            }
+            if (state.key == state.node->key) {
+                state.stage = 0;
+                results[state.i] = state.node->value;
+                num_finished++;
+            } else {
+                ++state.node;
+                if (state.node == state.end) {
+                    throw out_of_range("Key not found.");
+                }
+                state.stage = 1;
+                __builtin_prefetch(&(*state.node), 0, 3);
+            }
+        }
+    }
+}
+
+
+template <typename K, typename V, typename Hash, typename Index>
+coroutine HashMap<K, V, Hash, Index>::get_co(const K& key, size_t key_hash, std::vector<V>& results, const int i){
+    auto& bucket = bucket_for(key_hash);
+
+    // prefetch bucket (list head)
+    co_await prefetch(&bucket, sizeof(bucket));
+
+
+    auto node = bucket.begin();
+    auto end = bucket.end();
+    while (node != end) {
+        co_await prefetch(&(*node), sizeof(*node));
+        if (auto* bytes = KeyTraits<K>::out_of_line_bytes(node->key, key)) {
+            co_await prefetch(bytes);
+        }
+        if (node->key == key) {
+            results.at(i) = node->value;
+            co_return;
+        }
+        ++node;
+    }
+    throw out_of_range("Key not found");
+}
+
+template <typename K, typename V, typename Hash, typename Index>
+coroutine HashMap<K, V, Hash, Index>::get_co_exp(const K &key, size_t key_hash, std::vector<V> &results, const int i)
+{
+    auto &bucket = bucket_for(key_hash);
+
+    // prefetch bucket(list head)
+    co_await prefetch<SuspendOnMiss>(&bucket, sizeof(bucket));
+
+    auto node = bucket.begin();
+    auto end = bucket.end();
+    while (node != end)
+    {
+        co_await prefetch<SuspendOnMiss>(&(*node), sizeof(*node));
+        if (auto *bytes = KeyTraits<K>::out_of_line_bytes(node->key, key))
+        {
+            co_await prefetch<SuspendOnMiss>(bytes);
+        }
+        if (node->key == key)
+        {
+            results.at(i) = node->value;
+            co_return;
+        }
+        ++node;
+    }
+    throw out_of_range("Key not found");
+}
+
+template <typename K, typename V, typename Hash, typename Index>
+coroutine HashMap<K, V, Hash, Index>::profile_get_co_exp(const K &key, size_t key_hash, std::vector<V> &results, const int i)
+{
+    size_t prefetch_count = 0;
+    bool assume_cached = true;
+    auto &bucket = bucket_for(key_hash);
+
+    if (!is_in_tlb_prefetch_profile(&bucket, prefetch_count, profiler, assume_cached))
+    {
+        co_await std::suspend_always{};
+    }
+
+    auto node = bucket.begin();
+    auto end = bucket.end();
+    while (node != end)
+    {
+        if (!is_in_tlb_prefetch_profile(&(*node), prefetch_count, profiler, assume_cached))
+        {
+            co_await std::suspend_always{};
+        }
+        if (auto *bytes = KeyTraits<K>::out_of_line_bytes(node->key, key); bytes && !is_in_tlb_prefetch_profile(bytes, prefetch_count, profiler, assume_cached))
+        {
+            co_await std::suspend_always{};
+        }
+        if (node->key == key)
+        {
+            results.at(i) = node->value;
+            co_return;
+        }
+        ++node;
+    }
+    throw out_of_range("Key not found");
+}
+
+template <typename K, typename V, typename Hash, typename Index>
+void HashMap<K, V, Hash, Index>::vectorized_get_coroutine(const std::vector<K>& keys, std::vector<V>& results, int group_size) {
+    auto hashes = hash_batch(keys);
+    interleave(keys.size(), group_size, [&](size_t i)
+               { return get_co(keys[i], hashes[i], results, i); });
+}
+
+template <typename K, typename V, typename Hash, typename Index>
+void HashMap<K, V, Hash, Index>::vectorized_get_coroutine(const std::vector<K> &keys, std::vector<V> &results, int group_size, WorkStealingExecutor &executor)
+{
+    executor.run(keys.size(), group_size, [&](size_t i)
+                 { return get_co(keys[i], Hash{}(keys[i]), results, i); });
+}
+
+template <typename K, typename V, typename Hash, typename Index>
+void HashMap<K, V, Hash, Index>::profile_vectorized_get_coroutine_exp(const std::vector<K> &keys, std::vector<V> &results, int group_size)
+{
+    auto hashes = hash_batch(keys);
+    interleave(keys.size(), group_size, [&](size_t i)
+               { return profile_get_co_exp(keys[i], hashes[i], results, i); });
+}
+
+template <typename K, typename V, typename Hash, typename Index>
+void HashMap<K, V, Hash, Index>::vectorized_get_coroutine_exp(const std::vector<K> &keys, std::vector<V> &results, int group_size)
+{
+    auto hashes = hash_batch(keys);
+    interleave(keys.size(), group_size, [&](size_t i)
+               { return get_co_exp(keys[i], hashes[i], results, i); });
+}
+
+template <typename K, typename V, typename Hash, typename Index>
+size_t HashMap<K, V, Hash, Index>::vectorized_find(const std::vector<K> &keys, std::vector<V> &results, std::vector<bool> &found)
+{
+    found.assign(keys.size(), false);
+    size_t num_found = 0;
+    for (size_t i = 0; i < keys.size(); i++)
+    {
+        for (auto &node : bucket_of(keys[i]))
+        {
+            if (node.key == keys[i])
+            {
+                results[i] = node.value;
+                found[i] = true;
+                num_found++;
+                break;
+            }
+        }
+    }
+    return num_found;
+}
+
+template <typename K, typename V, typename Hash, typename Index>
+size_t HashMap<K, V, Hash, Index>::vectorized_find_gp(const std::vector<K> &keys, std::vector<V> &results, std::vector<bool> &found)
+{
+    // states:
+    // -1: Bucket (list head) prefetched
+    //  0: List node prefetched
+    //  1: Finished, element found or missing
+    //  2: Out-of-line key bytes prefetched
+    std::vector<int> states(keys.size(), -1);
+    std::vector<Chain *> buckets(keys.size());
+    std::vector<typename std::list<Node<K, V>>::iterator> nodes(keys.size());
+    found.assign(keys.size(), false);
+
+    auto hashes = hash_batch(keys);
+    for (size_t i = 0; i < keys.size(); i++)
+    {
+        buckets[i] = &bucket_for(hashes[i]);
+        __builtin_prefetch(buckets[i], 0, 3);
+    }
+
+    size_t finished = 0;
+    size_t num_found = 0;
+    while (finished < keys.size())
+    {
+        for (size_t i = 0; i < keys.size(); i++)
+        {
+            int &state = states[i];
+            if (state == -1)
+            {
+                if (buckets[i]->empty())
+                {
+                    state = 1;
+                    ++finished;
+                    continue;
+                }
+                nodes[i] = buckets[i]->begin();
+                __builtin_prefetch(&(*nodes[i]), 0, 3);
+                state = 0;
+            }
+            else if (state == 0 || state == 2)
+            {
+                auto &node = nodes[i];
+                if (state == 0)
+                {
+                    if (auto *bytes = KeyTraits<K>::out_of_line_bytes(node->key, keys[i]))
+                    {
+                        __builtin_prefetch(bytes, 0, 3);
+                        state = 2;
+                        continue;
+                    }
+                }
+                if (node->key == keys[i])
+                {
+                    results[i] = node->value;
+                    found[i] = true;
+                    num_found++;
+                    state = 1;
+                    ++finished;
+                    continue;
+                }
+                ++node;
+                if (node == buckets[i]->end())
+                {
+                    state = 1;
+                    ++finished;
+                    continue;
+                }
+                state = 0;
+                __builtin_prefetch(&(*node), 0, 3);
+            }
+        }
+    }
+    return num_found;
+}
+
+template <typename K, typename V, typename Hash, typename Index>
+size_t HashMap<K, V, Hash, Index>::vectorized_find_amac(const std::vector<K> &keys, std::vector<V> &results, std::vector<bool> &found, int group_size)
+{
+    CircularBuffer<AMAC_state> buff(group_size);
+    auto hashes = hash_batch(keys);
+    found.assign(keys.size(), false);
+
+    size_t num_finished = 0;
+    size_t num_found = 0;
+    size_t i = 0;
+    while (num_finished < keys.size())
+    {
+        AMAC_state &state = buff.next_state();
+
+        if (state.stage == 0)
+        {
+            if (i >= keys.size())
+            {
+                continue;
+            }
+            state.i = i;
+            state.key = keys[i];
+            state.bucket = &bucket_for(hashes[i++]);
+            state.stage = 1;
+            __builtin_prefetch(state.bucket, 0, 3);
+        }
+        else if (state.stage == 1)
+        {
+            if (state.bucket->empty())
+            {
+                state.stage = 0;
+                num_finished++;
+                continue;
+            }
+            state.node = state.bucket->begin();
+            state.end = state.bucket->end();
+            state.stage = 2;
+            __builtin_prefetch(&(*state.node), 0, 3);
+        }
+        else
+        {
+            // stage 2: node prefetched, stage 3: out-of-line key bytes prefetched
+            if (state.stage == 2)
+            {
+                if (auto *bytes = KeyTraits<K>::out_of_line_bytes(state.node->key, state.key))
+                {
+                    __builtin_prefetch(bytes, 0, 3);
+                    state.stage = 3;
+                    continue;
+                }
+            }
+            if (state.key == state.node->key)
+            {
+                results[state.i] = state.node->value;
+                found[state.i] = true;
+                num_found++;
+                state.stage = 0;
+                num_finished++;
+                continue;
+            }
+            ++state.node;
+            if (state.node == state.end)
+            {
+                state.stage = 0;
+                num_finished++;
+                continue;
+            }
+            state.stage = 2;
+            __builtin_prefetch(&(*state.node), 0, 3);
+        }
+    }
+    return num_found;
+}
+
+template <typename K, typename V, typename Hash, typename Index>
+coroutine HashMap<K, V, Hash, Index>::find_co(const K &key, size_t key_hash, std::vector<V> &results, std::vector<bool> &found, const int i)
+{
+    auto &bucket = bucket_for(key_hash);
+
+    // prefetch bucket (list head)
+    co_await prefetch(&bucket, sizeof(bucket));
+
+    for (auto node = bucket.begin(); node != bucket.end(); ++node)
+    {
+        co_await prefetch(&(*node), sizeof(*node));
+        if (auto *bytes = KeyTraits<K>::out_of_line_bytes(node->key, key))
+        {
+            co_await prefetch(bytes);
+        }
+        if (node->key == key)
+        {
+            results[i] = node->value;
+            found[i] = true;
+            co_return;
+        }
+    }
+}
+
+template <typename K, typename V, typename Hash, typename Index>
+coroutine HashMap<K, V, Hash, Index>::find_co_exp(const K &key, size_t key_hash, std::vector<V> &results, std::vector<bool> &found, const int i)
+{
+    auto &bucket = bucket_for(key_hash);
+
+    // prefetch bucket (list head)
+    co_await prefetch<SuspendOnMiss>(&bucket, sizeof(bucket));
+
+    for (auto node = bucket.begin(); node != bucket.end(); ++node)
+    {
+        co_await prefetch<SuspendOnMiss>(&(*node), sizeof(*node));
+        if (auto *bytes = KeyTraits<K>::out_of_line_bytes(node->key, key))
+        {
+            co_await prefetch<SuspendOnMiss>(bytes);
+        }
+        if (node->key == key)
+        {
+            results[i] = node->value;
+            found[i] = true;
+            co_return;
+        }
+    }
+}
+
+template <typename K, typename V, typename Hash, typename Index>
+size_t HashMap<K, V, Hash, Index>::vectorized_find_coroutine(const std::vector<K> &keys, std::vector<V> &results, std::vector<bool> &found, int group_size)
+{
+    auto hashes = hash_batch(keys);
+    found.assign(keys.size(), false);
+    interleave(keys.size(), group_size, [&](size_t i)
+               { return find_co(keys[i], hashes[i], results, found, i); });
+    return std::count(found.begin(), found.end(), true);
+}
+
+template <typename K, typename V, typename Hash, typename Index>
+size_t HashMap<K, V, Hash, Index>::vectorized_find_coroutine_exp(const std::vector<K> &keys, std::vector<V> &results, std::vector<bool> &found, int group_size)
+{
+    auto hashes = hash_batch(keys);
+    found.assign(keys.size(), false);
+    interleave(keys.size(), group_size, [&](size_t i)
+               { return find_co_exp(keys[i], hashes[i], results, found, i); });
+    return std::count(found.begin(), found.end(), true);
+}
+
+template <typename K, typename V, typename Hash, typename Index>
+void HashMap<K, V, Hash, Index>::remove(const K& key) {
+    migrate(MIGRATION_BUCKETS_PER_OPERATION);
+    auto& bucket = bucket_of(key);
+    for (auto it = bucket.begin(); it != bucket.end(); ++it) {
+        if ((*it).key == key) {
+            bucket.erase(it);
+            size--;
+            return;
+        }
+    }
+    throw out_of_range("Key not found");
+}
+
+template <typename K, typename V, typename Hash, typename Index>
+void HashMap<K, V, Hash, Index>::apply_found(Chain &bucket, typename std::list<Node<K, V>>::iterator node, const Operation<K, V> &operation)
+{
+    switch (operation.type)
+    {
+    case OperationType::Insert:
+        break;
+    case OperationType::Upsert:
+        node->value = operation.value;
+        break;
+    case OperationType::Remove:
+        bucket.erase(node);
+        size--;
+        batch_removed++;
+        break;
+    case OperationType::Merge:
+        // Mixed batches of other value types are rejected upfront.
+        if constexpr (Mergeable<V>)
+        {
+            merge_value(node->value, operation.value);
+        }
+        break;
+    }
+}
+
+template <typename K, typename V, typename Hash, typename Index>
+void HashMap<K, V, Hash, Index>::check_mergeable(const std::vector<Operation<K, V>> &operations) const
+{
+    if constexpr (!Mergeable<V>)
+    {
+        for (auto &operation : operations)
+        {
+            if (operation.type == OperationType::Merge)
+            {
+                throw std::invalid_argument("Merging requires a value type with operator+=");
+            }
+        }
+    }
+}
+
+template <typename K, typename V, typename Hash, typename Index>
+void HashMap<K, V, Hash, Index>::apply_missing(Chain &bucket, const Operation<K, V> &operation)
+{
+    if (operation.type == OperationType::Remove)
+    {
+        return;
+    }
+    bucket.emplace_back(operation.key, operation.value);
+    size++;
+}
+
+template <typename K, typename V, typename Hash, typename Index>
+template <typename OperationAt>
+void HashMap<K, V, Hash, Index>::apply_chunk_amac(size_t begin, size_t end, OperationAt operation_at, int group_size)
+{
+    auto hashes = hash_batch(end - begin, [&](size_t i)
+                             { return operation_at(begin + i).key; });
+
+    // The buffer is scanned for bucket conflicts, thus we cannot use a CircularBuffer here.
+    std::vector<AMAC_write_state> states(group_size);
+
+    size_t num_operations = end - begin;
+    size_t num_finished = 0;
+    size_t i = 0;
+    int next = 0;
+    while (num_finished < num_operations)
+    {
+        AMAC_write_state &state = states[next];
+        next = (next + 1) % group_size;
+
+        if (state.stage == 0)
+        {
+            if (i >= num_operations)
+            {
+                continue;
+            }
+            auto *bucket = &bucket_for(hashes[i]);
+            bool conflict = std::any_of(states.begin(), states.end(), [&](auto &other)
+                                        { return other.stage != 0 && other.bucket == bucket; });
+            if (conflict)
+            {
+                // Wait until the in-flight operation on this bucket retired to keep the batch order.
+                continue;
+            }
+            state.operation = operation_at(begin + i++);
+            state.bucket = bucket;
+            state.stage = 1;
+            prefetch_line<1>(bucket);
+        }
+        else if (state.stage == 1)
+        {
+            auto &bucket = *state.bucket;
+            state.node = bucket.begin();
+            state.end = bucket.end();
+            if (state.node == state.end)
+            {
+                apply_missing(bucket, state.operation);
+                state.stage = 0;
+                num_finished++;
+                continue;
+            }
+            state.stage = 2;
+            prefetch_line<1>(&(*state.node));
+        }
+        else
+        {
+            // stage 2: node prefetched, stage 3: out-of-line key bytes prefetched
+            if (state.stage == 2)
+            {
+                if (auto *bytes = KeyTraits<K>::out_of_line_bytes(state.node->key, state.operation.key))
+                {
+                    __builtin_prefetch(bytes, 0, 3);
+                    state.stage = 3;
+                    continue;
+                }
+            }
+            if (state.node->key == state.operation.key)
+            {
+                apply_found(*state.bucket, state.node, state.operation);
+                state.stage = 0;
+                num_finished++;
+                continue;
+            }
+            ++state.node;
+            if (state.node == state.end)
+            {
+                apply_missing(*state.bucket, state.operation);
+                state.stage = 0;
+                num_finished++;
+                continue;
+            }
+            state.stage = 2;
+            prefetch_line<1>(&(*state.node));
+        }
+    }
+}
+
+template <typename K, typename V, typename Hash, typename Index>
+template <typename OperationAt>
+size_t HashMap<K, V, Hash, Index>::vectorized_apply_amac(size_t num_operations, OperationAt operation_at, int group_size)
+{
+    batch_removed = 0;
+    apply_in_chunks(num_operations, [&](size_t begin, size_t end)
+                    { apply_chunk_amac(begin, end, operation_at, group_size); });
+    return batch_removed;
+}
+
+template <typename K, typename V, typename Hash, typename Index>
+coroutine HashMap<K, V, Hash, Index>::apply_co(const Operation<K, V> operation, Chain &bucket)
+{
+    // prefetch bucket (list head), it is written when nodes are added or removed
+    co_await prefetch<SuspendAlways, 1>(&bucket, sizeof(bucket));
+
+    for (auto node = bucket.begin(); node != bucket.end(); ++node)
+    {
+        co_await prefetch<SuspendAlways, 1>(&(*node), sizeof(*node));
+        if (auto *bytes = KeyTraits<K>::out_of_line_bytes(node->key, operation.key))
+        {
+            co_await prefetch(bytes);
+        }
+        if (node->key == operation.key)
+        {
+            apply_found(bucket, node, operation);
+            co_return;
+        }
+    }
+    apply_missing(bucket, operation);
+}
+
+template <typename K, typename V, typename Hash, typename Index>
+template <typename OperationAt>
+void HashMap<K, V, Hash, Index>::apply_chunk_coroutine(size_t begin, size_t end, OperationAt operation_at, int group_size)
+{
+    auto hashes = hash_batch(end - begin, [&](size_t i)
+                             { return operation_at(begin + i).key; });
+
+    // In-flight coroutines are scanned for bucket conflicts, thus we cannot use a CircularBuffer here.
+    std::vector<coroutine_handle<promise>> handles(group_size);
+    std::vector<Chain *> buckets(group_size, nullptr);
+
+    size_t num_operations = end - begin;
+    size_t num_finished = 0;
+    size_t i = 0;
+    int next = 0;
+    while (num_finished < num_operations)
+    {
+        coroutine_handle<promise> &handle = handles[next];
+        Chain *&bucket = buckets[next];
+        next = (next + 1) % group_size;
+
+        if (handle && handle.done())
+        {
+            num_finished++;
+            handle.destroy();
+            handle = nullptr;
+            bucket = nullptr;
+        }
+
+        if (!handle)
+        {
+            if (i >= num_operations)
+            {
+                continue;
+            }
+            auto *target = &bucket_for(hashes[i]);
+            if (std::find(buckets.begin(), buckets.end(), target) != buckets.end())
+            {
+                // Wait until the in-flight operation on this bucket retired to keep the batch order.
+                continue;
+            }
+            handle = apply_co(operation_at(begin + i++), *target);
+            bucket = target;
+        }
+
+        handle.resume();
+    }
+}
+
+template <typename K, typename V, typename Hash, typename Index>
+template <typename OperationAt>
+size_t HashMap<K, V, Hash, Index>::vectorized_apply_coroutine(size_t num_operations, OperationAt operation_at, int group_size)
+{
+    batch_removed = 0;
+    apply_in_chunks(num_operations, [&](size_t begin, size_t end)
+                    { apply_chunk_coroutine(begin, end, operation_at, group_size); });
+    return batch_removed;
+}
+
+template <typename K, typename V, typename Hash, typename Index>
+void HashMap<K, V, Hash, Index>::vectorized_insert_amac(const std::vector<K> &keys, const std::vector<V> &values, int group_size)
+{
+    vectorized_apply_amac(keys.size(), [&](size_t i)
+                          { return Operation<K, V>{OperationType::Insert, keys[i], values[i]}; }, group_size);
+}
+
+template <typename K, typename V, typename Hash, typename Index>
+void HashMap<K, V, Hash, Index>::vectorized_insert_coroutine(const std::vector<K> &keys, const std::vector<V> &values, int group_size)
+{
+    vectorized_apply_coroutine(keys.size(), [&](size_t i)
+                               { return Operation<K, V>{OperationType::Insert, keys[i], values[i]}; }, group_size);
+}
+
+template <typename K, typename V, typename Hash, typename Index>
+void HashMap<K, V, Hash, Index>::vectorized_upsert_amac(const std::vector<K> &keys, const std::vector<V> &values, int group_size)
+{
+    vectorized_apply_amac(keys.size(), [&](size_t i)
+                          { return Operation<K, V>{OperationType::Upsert, keys[i], values[i]}; }, group_size);
+}
+
+template <typename K, typename V, typename Hash, typename Index>
+void HashMap<K, V, Hash, Index>::vectorized_upsert_coroutine(const std::vector<K> &keys, const std::vector<V> &values, int group_size)
+{
+    vectorized_apply_coroutine(keys.size(), [&](size_t i)
+                               { return Operation<K, V>{OperationType::Upsert, keys[i], values[i]}; }, group_size);
+}
+
+template <typename K, typename V, typename Hash, typename Index>
+size_t HashMap<K, V, Hash, Index>::vectorized_remove_amac(const std::vector<K> &keys, int group_size)
+{
+    return vectorized_apply_amac(keys.size(), [&](size_t i)
+                          { return Operation<K, V>{OperationType::Remove, keys[i], V{}}; }, group_size);
+}
+
+template <typename K, typename V, typename Hash, typename Index>
+size_t HashMap<K, V, Hash, Index>::vectorized_remove_coroutine(const std::vector<K> &keys, int group_size)
+{
+    return vectorized_apply_coroutine(keys.size(), [&](size_t i)
+                               { return Operation<K, V>{OperationType::Remove, keys[i], V{}}; }, group_size);
+}
+
+template <typename K, typename V, typename Hash, typename Index>
+void HashMap<K, V, Hash, Index>::vectorized_merge_amac(const std::vector<K> &keys, const std::vector<V> &values, int group_size)
+    requires Mergeable<V>
+{
+    vectorized_apply_amac(keys.size(), [&](size_t i)
+                          { return Operation<K, V>{OperationType::Merge, keys[i], values[i]}; }, group_size);
+}
+
+template <typename K, typename V, typename Hash, typename Index>
+void HashMap<K, V, Hash, Index>::vectorized_merge_coroutine(const std::vector<K> &keys, const std::vector<V> &values, int group_size)
+    requires Mergeable<V>
+{
+    vectorized_apply_coroutine(keys.size(), [&](size_t i)
+                               { return Operation<K, V>{OperationType::Merge, keys[i], values[i]}; }, group_size);
+}
+
+template <typename K, typename V, typename Hash, typename Index>
+size_t HashMap<K, V, Hash, Index>::vectorized_mixed_amac(const std::vector<Operation<K, V>> &operations, int group_size)
+{
+    check_mergeable(operations);
+    return vectorized_apply_amac(operations.size(), [&](size_t i) -> const Operation<K, V> &
+                          { return operations[i]; }, group_size);
+}
+
+template <typename K, typename V, typename Hash, typename Index>
+size_t HashMap<K, V, Hash, Index>::vectorized_mixed_coroutine(const std::vector<Operation<K, V>> &operations, int group_size)
+{
+    check_mergeable(operations);
+    return vectorized_apply_coroutine(operations.size(), [&](size_t i) -> const Operation<K, V> &
+                               { return operations[i]; }, group_size);
+}
+
+template <typename K, typename V, typename Hash, typename Index>
+bool HashMap<K, V, Hash, Index>::contains(const K& key) {
+
+    for (auto& node : bucket_of(key)) {
+        if (node.key == key) {
+            return true;
+        }
+    }
+    return false;
+}
+
+template <typename K, typename V, typename Hash, typename Index>
+size_t HashMap<K, V, Hash, Index>::getSize() const {
+    return size;
+}
+
+template <typename K, typename V, typename Hash, typename Index>
+bool HashMap<K, V, Hash, Index>::isEmpty() const {
+    return size == 0;
+}
+
+template <typename K, typename V, typename Hash, typename Index>
+size_t HashMap<K, V, Hash, Index>::bucket_count() const
+{
+    return capacity;
+}
+
+template <typename K, typename V, typename Hash, typename Index>
+const void *HashMap<K, V, Hash, Index>::address_of(const K &key)
+{
+    return &bucket_of(key);
+}
+
+template <typename K, typename V, typename Hash, typename Index>
+bool HashMap<K, V, Hash, Index>::is_resizing() const
+{
+    return migrated < old_capacity;
+}
+
+template <typename K, typename V, typename Hash, typename Index>
+void HashMap<K, V, Hash, Index>::compact()
+{
+    migrate(old_capacity);
+
+    auto *slab_resource = dynamic_cast<SlabMemoryResource *>(&memory_resource);
+    if (slab_resource)
+    {
+        slab_resource->begin_compaction();
+    }
+    for (size_t index = 0; index < capacity; ++index)
+    {
+        if (index + MIGRATION_PREFETCH_DISTANCE < capacity && !table[index + MIGRATION_PREFETCH_DISTANCE].empty())
+        {
+            __builtin_prefetch(&table[index + MIGRATION_PREFETCH_DISTANCE].front(), 0, 3);
+        }
+
+        auto &bucket = table[index];
+        Chain clustered(&memory_resource);
+        for (auto &node : bucket)
+        {
+            clustered.emplace_back(std::move(node.key), std::move(node.value));
+        }
+        bucket.swap(clustered);
+    }
+    if (slab_resource)
+    {
+        slab_resource->end_compaction();
+    }
+}
+
+template <typename K, typename V, typename Hash, typename Index>
+template <typename Function>
+void HashMap<K, V, Hash, Index>::for_each(Function function)
+{
+    for (auto *chains : {&old_table, &table})
+    {
+        for (auto &bucket : *chains)
+        {
+            for (auto &node : bucket)
+            {
+                function(node.key, node.value);
+            }
+        }
+    }
+}
@@ -0,0 +1,142 @@
+#pragma once
+
+#include <vector>
+#include <coroutine>
+#include <algorithm>
+#include <type_traits>
+
+#include "coroutine.hpp"
+#include "utils/utils.cpp"
+
+/*
+    Scheduling policies of interleave. A policy runs num_inputs coroutines created by factory(i) with at most
+    group_size of them alive at once, every coroutine is destroyed once it is done.
+*/
+
+// Every coroutine owns a slot of a CircularBuffer, the slots are resumed in turn. A finished coroutine is
+// replaced by the next input right away.
+struct RoundRobin
+{
+    template <typename Factory>
+    static void run(size_t num_inputs, size_t group_size, Factory &factory)
+    {
+        CircularBuffer<std::coroutine_handle<promise>> buff(group_size);
+
+        size_t num_finished = 0;
+        size_t i = 0;
+        while (num_finished < num_inputs)
+        {
+            std::coroutine_handle<promise> &handle = buff.next_state();
+            if (!handle)
+            {
+                if (i >= num_inputs)
+                {
+                    continue;
+                }
+                handle = factory(i++);
+            }
+            else if (handle.done())
+            {
+                num_finished++;
+                handle.destroy();
+                if (i >= num_inputs)
+                {
+                    handle = nullptr;
+                    continue;
+                }
+                handle = factory(i++);
+            }
+            handle.resume();
+        }
+    }
+};
+
+// A new coroutine runs up to its first suspension right away, one that does not suspend (e.g. a coroutine_exp
+// lookup that hits the cache) finishes without ever entering the rotation. Suspended coroutines are kept in a
+// FIFO and resumed oldest first, so the one whose prefetch was issued first goes next.
+struct ReadyFirst
+{
+    template <typename Factory>
+    static void run(size_t num_inputs, size_t group_size, Factory &factory)
+    {
+        std::vector<std::coroutine_handle<promise>> queue(group_size);
+        size_t head = 0;
+        size_t queued = 0;
+        size_t i = 0;
+
+        auto step = [&](std::coroutine_handle<promise> handle)
+        {
+            handle.resume();
+            if (handle.done())
+            {
+                handle.destroy();
+                return false;
+            }
+            queue[(head + queued++) % group_size] = handle;
+            return true;
+        };
+
+        while (i < num_inputs || queued > 0)
+        {
+            while (queued < group_size && i < num_inputs)
+            {
+                step(factory(i++));
+            }
+            if (queued == 0)
+            {
+                continue;
+            }
+            auto handle = queue[head];
+            head = (head + 1) % group_size;
+            queued--;
+            step(handle);
+        }
+    }
+};
+
+// Round robin with at most MAX_IN_FLIGHT coroutines alive whatever the group size, e.g. the number of line fill
+// buffers, so that additional coroutines only add switches without adding parallel misses.
+template <size_t MAX_IN_FLIGHT>
+struct BoundedInFlight
+{
+    template <typename Factory>
+    static void run(size_t num_inputs, size_t group_size, Factory &factory)
+    {
+        RoundRobin::run(num_inputs, std::min(group_size, MAX_IN_FLIGHT), factory);
+    }
+};
+
+/*
+    Runs the coroutines factory(0), ..., factory(num_inputs - 1) interleaved, group_size of them at a time. A
+    structure only writes the coroutine of a single lookup and hands its construction to interleave, the policy
+    decides the order in which the suspended coroutines are resumed. With a group size of one the coroutines
+    run one after the other without any bookkeeping.
+*/
+template <typename Policy = RoundRobin, typename Factory>
+void interleave(size_t num_inputs, size_t group_size, Factory factory)
+{
+    group_size = std::min(group_size, num_inputs);
+    if (group_size <= 1)
+    {
+        for (size_t i = 0; i < num_inputs; ++i)
+        {
+            std::coroutine_handle<promise> handle = factory(i);
+            while (!handle.done())
+            {
+                handle.resume();
+            }
+            handle.destroy();
+        }
+        return;
+    }
+    Policy::run(num_inputs, group_size, factory);
+}
+
+// Same as above for the elements of a container, the coroutines are created by factory(inputs[i], i).
+template <typename Policy = RoundRobin, typename Inputs, typename Factory>
+    requires(!std::is_integral_v<Inputs>)
+void interleave(const Inputs &inputs, size_t group_size, Factory factory)
+{
+    interleave<Policy>(inputs.size(), group_size, [&](size_t i)
+                       { return factory(inputs[i], i); });
+}
@@ -0,0 +1,157 @@
+#include <algorithm>
+#include <bit>
+#include <stdexcept>
+#include <string>
+
+#include "slab_memory_resource.hpp"
+
+SlabMemoryResource::SlabMemoryResource(std::size_t object_size, std::pmr::memory_resource &upstream, std::size_t slab_size) : slab_size(slab_size), upstream(upstream)
+{
+    if (!std::has_single_bit(slab_size) || slab_size < 2 * SLAB_HEADER_SIZE)
+    {
+        throw std::invalid_argument("Slab size has to be a power of two of at least " + std::to_string(2 * SLAB_HEADER_SIZE) + " bytes.");
+    }
+    // Slots have to hold the free list link and keep pointers inside them aligned.
+    slot_size = std::max(object_size, sizeof(FreeSlot));
+    slot_size = (slot_size + alignof(FreeSlot) - 1) & ~(alignof(FreeSlot) - 1);
+    if (slot_size > slab_size - SLAB_HEADER_SIZE)
+    {
+        throw std::invalid_argument("Object size exceeds the slab size.");
+    }
+    slot_alignment = std::min(slot_size & -slot_size, SLAB_HEADER_SIZE);
+}
+
+SlabMemoryResource::~SlabMemoryResource()
+{
+    for (auto *slab : slabs)
+    {
+        upstream.deallocate(slab, slab_size, slab_size);
+    }
+}
+
+bool SlabMemoryResource::is_pooled(std::size_t bytes, std::size_t alignment) const
+{
+    return bytes <= slot_size && alignment <= slot_alignment;
+}
+
+SlabMemoryResource::Slab *SlabMemoryResource::slab_of(void *p) const
+{
+    return reinterpret_cast<Slab *>(reinterpret_cast<uintptr_t>(p) & ~(slab_size - 1));
+}
+
+void SlabMemoryResource::add_slab()
+{
+    auto *slab = static_cast<Slab *>(upstream.allocate(slab_size, slab_size));
+    slab->live = 0;
+    slabs.push_back(slab);
+    bump = reinterpret_cast<char *>(slab) + SLAB_HEADER_SIZE;
+    bump_end = reinterpret_cast<char *>(slab) + slab_size;
+}
+
+void SlabMemoryResource::release_bump_slots()
+{
+    for (; static_cast<std::size_t>(bump_end - bump) >= slot_size; bump += slot_size)
+    {
+        free_list = new (bump) FreeSlot{free_list};
+    }
+    bump = bump_end = nullptr;
+}
+
+void *SlabMemoryResource::do_allocate(std::size_t bytes, std::size_t alignment)
+{
+    if (!is_pooled(bytes, alignment))
+    {
+        return upstream.allocate(bytes, alignment);
+    }
+
+    void *p;
+    if (free_list && !compacting)
+    {
+        p = free_list;
+        free_list = free_list->next;
+    }
+    else
+    {
+        if (static_cast<std::size_t>(bump_end - bump) < slot_size)
+        {
+            add_slab();
+        }
+        p = bump;
+        bump += slot_size;
+    }
+    slab_of(p)->live++;
+    return p;
+}
+
+void SlabMemoryResource::do_deallocate(void *p, std::size_t bytes, std::size_t alignment)
+{
+    if (!is_pooled(bytes, alignment))
+    {
+        upstream.deallocate(p, bytes, alignment);
+        return;
+    }
+
+    slab_of(p)->live--;
+    free_list = new (p) FreeSlot{free_list};
+}
+
+bool SlabMemoryResource::do_is_equal(const memory_resource &other) const noexcept
+{
+    return &other == this;
+}
+
+void SlabMemoryResource::begin_compaction()
+{
+    // Start on a fresh slab, objects placed during the compaction must not interleave with the old ones.
+    release_bump_slots();
+    compacting = true;
+}
+
+void SlabMemoryResource::end_compaction()
+{
+    compacting = false;
+
+    Slab *current = bump ? slab_of(bump - 1) : nullptr;
+    std::vector<Slab *> released;
+    std::erase_if(slabs, [&](Slab *slab)
+                  {
+                      if (slab->live != 0 || slab == current)
+                      {
+                          return false;
+                      }
+                      released.push_back(slab);
+                      return true; });
+    if (released.empty())
+    {
+        return;
+    }
+
+    // Drop the free slots of the released slabs before their memory goes back to upstream.
+    std::sort(released.begin(), released.end());
+    FreeSlot **link = &free_list;
+    while (*link)
+    {
+        if (std::binary_search(released.begin(), released.end(), slab_of(*link)))
+        {
+            *link = (*link)->next;
+        }
+        else
+        {
+            link = &(*link)->next;
+        }
+    }
+    for (auto *slab : released)
+    {
+        upstream.deallocate(slab, slab_size, slab_size);
+    }
+}
+
+std::size_t SlabMemoryResource::object_size() const
+{
+    return slot_size;
+}
+
+std::size_t SlabMemoryResource::slab_count() const
+{
+    return slabs.size();
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <memory_resource>
+
+#include "numa_memory_resource.hpp"
+
+/**
+ * Pools objects of one fixed size on large slabs taken from an upstream resource (e.g. a NumaMemoryResource).
+ *
+ * Slots are handed out from a free list first, then by bumping through the newest slab, so objects allocated
+ * one after another end up in the same or adjacent cache lines. Allocations larger than the object size are
+ * forwarded to upstream.
+ *
+ * A compaction pass runs between begin_compaction() and end_compaction(): meanwhile freed slots are not reused,
+ * every new object is bumped onto fresh slabs in allocation order. Re-allocating a data structure in traversal
+ * order during that window lays it out sequentially, slabs left empty afterwards are returned to upstream.
+ */
+class SlabMemoryResource : public std::pmr::memory_resource
+{
+public:
+    // The slab size has to be a power of two, slabs are aligned to it to find their header.
+    explicit SlabMemoryResource(std::size_t object_size, std::pmr::memory_resource &upstream, std::size_t slab_size = HUGE_PAGE_SIZE);
+
+    ~SlabMemoryResource();
+
+    SlabMemoryResource(const SlabMemoryResource &) = delete;
+    SlabMemoryResource &operator=(const SlabMemoryResource &) = delete;
+
+    void *do_allocate(std::size_t bytes, std::size_t alignment) override;
+    void do_deallocate(void *p, std::size_t bytes, std::size_t alignment) override;
+    bool do_is_equal(const memory_resource &other) const noexcept override;
+
+    void begin_compaction();
+    void end_compaction();
+
+    std::size_t object_size() const;
+    std::size_t slab_count() const;
+
+private:
+    // Occupies the first cache line of every slab.
+    struct Slab
+    {
+        std::size_t live;
+    };
+
+    struct FreeSlot
+    {
+        FreeSlot *next;
+    };
+
+    static constexpr std::size_t SLAB_HEADER_SIZE = 64;
+
+    std::size_t slot_size;
+    std::size_t slot_alignment;
+    std::size_t slab_size;
+    std::pmr::memory_resource &upstream;
+
+    std::vector<Slab *> slabs;
+    char *bump = nullptr;
+    char *bump_end = nullptr;
+    FreeSlot *free_list = nullptr;
+    bool compacting = false;
+
+    bool is_pooled(std::size_t bytes, std::size_t alignment) const;
+    Slab *slab_of(void *p) const;
+    void add_slab();
+    void release_bump_slots();
+};
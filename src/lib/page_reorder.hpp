@@ -0,0 +1,129 @@
+#pragma once
+
+#include <vector>
+#include <bit>
+#include <algorithm>
+#include <cstdint>
+#include <stdexcept>
+
+#include "technique.hpp"
+
+/*
+    Runs large lookup batches of a structure (RandomAccess, HashMap) in page order. The addresses the lookups load
+    first (address_of) are radix partitioned by page number and every partition is sorted by address, so the
+    lookups of one page run back to back, ordered by cache line. The reordered batch is executed with the chosen
+    technique and its results are scattered back into the caller's order. Consecutive lookups then share TLB
+    entries instead of each paying a page walk, at the price of the partitioning and the extra copies.
+
+    Batches smaller than min_batch_size are executed as they are.
+*/
+template <typename Structure, typename Key, typename Value>
+class PageReorder
+{
+public:
+    PageReorder(Structure &structure, size_t page_size, size_t min_batch_size = 4096);
+    void vectorized_get(const std::vector<Key> &keys, std::vector<Value> &results, Technique technique, size_t group_size);
+    size_t page_size() const;
+
+private:
+    static constexpr size_t MAX_PARTITIONS = 1 << 14;
+    static constexpr size_t KEYS_PER_PARTITION = 16;
+
+    Structure &structure;
+    size_t page_shift;
+    size_t min_batch_size;
+
+    std::vector<uintptr_t> addresses;
+    std::vector<size_t> partition_offsets;
+    std::vector<uint32_t> order;
+    std::vector<Key> ordered_keys;
+    std::vector<Value> ordered_results;
+    TechniqueBuffers<Key, Value> buffers;
+
+    void plan(const std::vector<Key> &keys);
+    void run(const std::vector<Key> &keys, std::vector<Value> &results, Technique technique, size_t group_size);
+};
+
+template <typename Structure, typename Key, typename Value>
+PageReorder<Structure, Key, Value>::PageReorder(Structure &structure, size_t page_size, size_t min_batch_size)
+    : structure(structure), page_shift(std::countr_zero(page_size)), min_batch_size(min_batch_size)
+{
+    if (!std::has_single_bit(page_size))
+    {
+        throw std::invalid_argument("PageReorder requires a power of two page size.");
+    }
+}
+
+template <typename Structure, typename Key, typename Value>
+void PageReorder<Structure, Key, Value>::plan(const std::vector<Key> &keys)
+{
+    size_t partitions = std::clamp<size_t>(std::bit_ceil(keys.size() / KEYS_PER_PARTITION), 1, MAX_PARTITIONS);
+    size_t mask = partitions - 1;
+
+    addresses.resize(keys.size());
+    partition_offsets.assign(partitions + 1, 0);
+    for (size_t i = 0; i < keys.size(); ++i)
+    {
+        addresses[i] = reinterpret_cast<uintptr_t>(structure.address_of(keys[i]));
+        partition_offsets[((addresses[i] >> page_shift) & mask) + 1]++;
+    }
+    for (size_t p = 0; p < partitions; ++p)
+    {
+        partition_offsets[p + 1] += partition_offsets[p];
+    }
+
+    order.resize(keys.size());
+    for (size_t i = 0; i < keys.size(); ++i)
+    {
+        order[partition_offsets[(addresses[i] >> page_shift) & mask]++] = i;
+    }
+
+    // The scatter advanced every offset to the end of its partition.
+    size_t begin = 0;
+    for (size_t p = 0; p < partitions; ++p)
+    {
+        size_t end = partition_offsets[p];
+        std::sort(order.begin() + begin, order.begin() + end, [&](uint32_t a, uint32_t b)
+                  { return addresses[a] < addresses[b]; });
+        begin = end;
+    }
+}
+
+template <typename Structure, typename Key, typename Value>
+void PageReorder<Structure, Key, Value>::run(const std::vector<Key> &keys, std::vector<Value> &results, Technique technique, size_t group_size)
+{
+    run_technique(structure, technique, keys, results, group_size, buffers);
+}
+
+template <typename Structure, typename Key, typename Value>
+void PageReorder<Structure, Key, Value>::vectorized_get(const std::vector<Key> &keys, std::vector<Value> &results, Technique technique, size_t group_size)
+{
+    if (keys.size() < min_batch_size)
+    {
+        run(keys, results, technique, group_size);
+        return;
+    }
+    if (keys.size() > UINT32_MAX)
+    {
+        throw std::length_error("PageReorder supports batches of less than 2^32 lookups.");
+    }
+
+    plan(keys);
+    ordered_keys.resize(keys.size());
+    ordered_results.resize(keys.size());
+    for (size_t i = 0; i < keys.size(); ++i)
+    {
+        ordered_keys[i] = keys[order[i]];
+    }
+    run(ordered_keys, ordered_results, technique, group_size);
+    for (size_t i = 0; i < keys.size(); ++i)
+    {
+        results[order[i]] = ordered_results[i];
+    }
+}
+
+template <typename Structure, typename Key, typename Value>
+size_t PageReorder<Structure, Key, Value>::page_size() const
+{
+    return size_t{1} << page_shift;
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <coroutine>
+#include <cstdint>
+#include <cstddef>
+
+#include "utils/utils.cpp"
+
+constexpr size_t PREFETCH_LINE_SIZE = 64;
+
+// Prefetches every cache line of [ptr, ptr + bytes), RW = 1 prefetches with write intent.
+template <int RW = 0>
+inline void prefetch_lines(const void *ptr, size_t bytes)
+{
+    auto line = reinterpret_cast<uintptr_t>(ptr) & ~(PREFETCH_LINE_SIZE - 1);
+    auto end = reinterpret_cast<uintptr_t>(ptr) + bytes;
+    do
+    {
+        prefetch_line<RW>(reinterpret_cast<const void *>(line));
+        line += PREFETCH_LINE_SIZE;
+    } while (line < end);
+}
+
+/*
+    Suspension policies of co_await prefetch. A policy issues the prefetches of the object and decides whether
+    the coroutine suspends afterwards.
+*/
+
+// Suspends after every prefetch, the classic coroutine lookup.
+struct SuspendAlways
+{
+    template <int RW>
+    static bool issue(const void *ptr, size_t bytes)
+    {
+        prefetch_lines<RW>(ptr, bytes);
+        return true;
+    }
+};
+
+// Only prefetches and continues, e.g. for objects that are known to be cached or to measure the switch overhead.
+struct SuspendNever
+{
+    template <int RW>
+    static bool issue(const void *ptr, size_t bytes)
+    {
+        prefetch_lines<RW>(ptr, bytes);
+        return false;
+    }
+};
+
+// Times the prefetch of the first line (is_in_tlb_and_prefetch) and suspends only if it did not complete in L1
+// latency. The remaining lines of the object are prefetched without probing, they share the page of the first one
+// and are mostly resident or missing together.
+struct SuspendOnMiss
+{
+    template <int RW>
+    static bool issue(const void *ptr, size_t bytes)
+    {
+        bool cached = is_in_tlb_and_prefetch<RW>(ptr);
+        auto first_line_end = (reinterpret_cast<uintptr_t>(ptr) | (PREFETCH_LINE_SIZE - 1)) + 1;
+        auto end = reinterpret_cast<uintptr_t>(ptr) + bytes;
+        if (end > first_line_end)
+        {
+            prefetch_lines<RW>(reinterpret_cast<const void *>(first_line_end), end - first_line_end);
+        }
+        return !cached;
+    }
+};
+
+template <typename Policy, int RW>
+struct prefetch_awaitable
+{
+    const void *ptr;
+    size_t bytes;
+    bool await_ready() const noexcept { return !Policy::template issue<RW>(ptr, bytes); }
+    void await_suspend(std::coroutine_handle<>) const noexcept {}
+    void await_resume() const noexcept {}
+};
+
+/*
+    co_await prefetch(ptr, bytes) prefetches the cache lines of an object and suspends the coroutine as the policy
+    decides, so that a lookup coroutine spells every step of a traversal as one line. RW = 1 prefetches with write
+    intent for objects the coroutine is going to modify.
+*/
+template <typename Policy = SuspendAlways, int RW = 0>
+prefetch_awaitable<Policy, RW> prefetch(const void *ptr, size_t bytes = 1)
+{
+    return {ptr, bytes};
+}
@@ -1,9 +1,19 @@
 #include <vector>
 #include <coroutine>
+#include <chrono>
+#include <random>
+#include <limits>
+#include <algorithm>
+#if defined(X86_64)
+#include <immintrin.h>
+#endif
 
 #include "random_access.hpp"
 #include "coroutine.hpp"
 #include "utils.cpp"
+#include "interleave.hpp"
+#include "prefetch.hpp"
+#include "executor.hpp"
 #include "types.hpp"
 
 /*
@@ -14,14 +24,54 @@
 */
 
 template <typename V>
-RandomAccess<V>::RandomAccess(size_t num_elements)
-    : num_elements(num_elements)
+RandomAccess<V>::RandomAccess(size_t num_elements, std::pmr::memory_resource &memory_resource)
+    : data(num_elements + GATHER_PADDING, &memory_resource), num_elements(num_elements)
 {
-    data = new V[num_elements];
     for (size_t i = 0; i < num_elements; ++i)
     {
         data[i] = i;
     }
+    distance = calibrate_prefetch_distance();
+}
+
+template <typename V>
+size_t RandomAccess<V>::calibrate_prefetch_distance()
+{
+    if (num_elements == 0)
+    {
+        return distance;
+    }
+    std::mt19937 gen(42);
+    std::uniform_int_distribution<size_t> dis(0, num_elements - 1);
+    std::vector<size_t> positions(CALIBRATION_LOOKUPS);
+    for (auto &pos : positions)
+    {
+        pos = dis(gen);
+    }
+    std::vector<V> results(CALIBRATION_LOOKUPS);
+
+    std::vector<size_t> distances;
+    for (size_t d = 1; d <= MAX_PREFETCH_DISTANCE; d *= 2)
+    {
+        distances.push_back(d);
+    }
+
+    // Untimed warm-up pass, then the distances take turns and each one keeps its fastest repetition, so neither
+    // the first touch of the data nor a single noisy run decide.
+    vectorized_get_pipelined(positions, results);
+    std::vector<double> times(distances.size(), std::numeric_limits<double>::max());
+    for (size_t repetition = 0; repetition < CALIBRATION_REPETITIONS; ++repetition)
+    {
+        for (size_t d = 0; d < distances.size(); ++d)
+        {
+            distance = distances[d];
+            auto start = std::chrono::high_resolution_clock::now();
+            vectorized_get_pipelined(positions, results);
+            auto end = std::chrono::high_resolution_clock::now();
+            times[d] = std::min(times[d], std::chrono::duration<double>(end - start).count());
+        }
+    }
+    return distances[std::min_element(times.begin(), times.end()) - times.begin()];
 }
 
 template <typename V>
@@ -33,8 +83,7 @@ V &RandomAccess<V>::get(size_t pos)
 template <typename V>
 coroutine RandomAccess<V>::get_co(size_t pos, std::vector<V> &results, int i)
 {
-    __builtin_prefetch(data + pos, 0, 3);
-    co_await std::suspend_always{};
+    co_await prefetch(data.data() + pos, sizeof(V));
     results[i] = data[pos];
     co_return;
 }
@@ -42,10 +91,7 @@ coroutine RandomAccess<V>::get_co(size_t pos, std::vector<V> &results, int i)
 template <typename V>
 coroutine RandomAccess<V>::get_co_exp(size_t pos, std::vector<V> &results, int i)
 {
-    if (is_in_tlb_and_prefetch(data + pos))
-    {
-        co_await std::suspend_always{};
-    }
+    co_await prefetch<SuspendOnMiss>(data.data() + pos, sizeof(V));
     results[i] = data[pos];
     co_return;
 }
@@ -59,6 +105,27 @@ void RandomAccess<V>::vectorized_get(const std::vector<size_t> &positions, std::
     }
 }
 
+template <typename V>
+void RandomAccess<V>::vectorized_get_pipelined(const std::vector<size_t> &positions, std::vector<V> &results)
+{
+    size_t count = positions.size();
+    size_t prologue = std::min(distance, count);
+    for (size_t i = 0; i < prologue; ++i)
+    {
+        __builtin_prefetch(data.data() + positions[i], 0, 3);
+    }
+    size_t i = 0;
+    for (; i + distance < count; ++i)
+    {
+        __builtin_prefetch(data.data() + positions[i + distance], 0, 3);
+        results[i] = data[positions[i]];
+    }
+    for (; i < count; ++i)
+    {
+        results[i] = data[positions[i]];
+    }
+}
+
 template <typename V>
 void RandomAccess<V>::vectorized_get_gp(const std::vector<size_t> &positions, std::vector<V> &results)
 {
@@ -66,7 +133,7 @@ void RandomAccess<V>::vectorized_get_gp(const std::vector<size_t> &positions, st
     // function logic. Here this is not required.
     for (auto pos : positions)
     {
-        __builtin_prefetch(data + pos, 0, 3);
+        __builtin_prefetch(data.data() + pos, 0, 3);
     }
     for (size_t i = 0; i < positions.size(); ++i)
     {
@@ -84,7 +151,7 @@ void RandomAccess<V>::vectorized_get_amac(const std::vector<size_t> &positions,
         size_t group_offset = group_iteration * group_size;
         for (size_t i = 0; i < std::min(group_size, positions.size() - group_offset); ++i)
         {
-            __builtin_prefetch(data + positions[group_offset + i], 0, 3);
+            __builtin_prefetch(data.data() + positions[group_offset + i], 0, 3);
         }
         for (size_t i = 0; i < std::min(group_size, positions.size() - group_offset); ++i)
         {
@@ -96,91 +163,340 @@ void RandomAccess<V>::vectorized_get_amac(const std::vector<size_t> &positions,
 template <typename V>
 void RandomAccess<V>::vectorized_get_coroutine(const std::vector<size_t> &positions, std::vector<V> &results, size_t group_size)
 {
-    CircularBuffer<std::coroutine_handle<promise>> buff(std::min(group_size, static_cast<size_t>(positions.size())));
+    interleave(positions.size(), group_size, [&](size_t i)
+               { return get_co(positions[i], results, i); });
+}
 
-    int num_finished = 0;
-    int i = 0;
+template <typename V>
+void RandomAccess<V>::vectorized_get_coroutine(const std::vector<size_t> &positions, std::vector<V> &results, size_t group_size, WorkStealingExecutor &executor)
+{
+    executor.run(positions.size(), group_size, [&](size_t i)
+                 { return get_co(positions[i], results, i); });
+}
 
-    while (num_finished < positions.size())
+template <typename V>
+void RandomAccess<V>::vectorized_get_coroutine_exp(const std::vector<size_t> &positions, std::vector<V> &results, size_t group_size)
+{
+    interleave(positions.size(), group_size, [&](size_t i)
+               { return get_co_exp(positions[i], results, i); });
+}
+
+template <typename V>
+template <typename Update>
+coroutine RandomAccess<V>::update_co(size_t pos, size_t i, Update &update)
+{
+    co_await prefetch<SuspendAlways, 1>(data.data() + pos, sizeof(V));
+    update(data[pos], i);
+    co_return;
+}
+
+template <typename V>
+template <typename Update>
+coroutine RandomAccess<V>::update_co_exp(size_t pos, size_t i, Update &update)
+{
+    co_await prefetch<SuspendOnMiss, 1>(data.data() + pos, sizeof(V));
+    update(data[pos], i);
+    co_return;
+}
+
+template <typename V>
+template <typename Update>
+void RandomAccess<V>::update_gp(const std::vector<size_t> &positions, Update update)
+{
+    for (auto pos : positions)
+    {
+        prefetch_line<1>(data.data() + pos);
+    }
+    for (size_t i = 0; i < positions.size(); ++i)
     {
-        std::coroutine_handle<promise> &handle = buff.next_state();
-        if (!handle)
+        update(data[positions[i]], i);
+    }
+}
+
+template <typename V>
+template <typename Update>
+void RandomAccess<V>::update_amac(const std::vector<size_t> &positions, size_t group_size, Update update)
+{
+    for (size_t group_offset = 0; group_offset < positions.size(); group_offset += group_size)
+    {
+        size_t group_end = std::min(group_offset + group_size, positions.size());
+        for (size_t i = group_offset; i < group_end; ++i)
         {
-            if (i < std::min(group_size, static_cast<size_t>(positions.size())))
-            {
-                handle = get_co(positions[i], results, i);
-                i++;
-            }
-            continue;
+            prefetch_line<1>(data.data() + positions[i]);
         }
+        for (size_t i = group_offset; i < group_end; ++i)
+        {
+            update(data[positions[i]], i);
+        }
+    }
+}
+
+template <typename V>
+template <typename Update, typename Coroutine>
+void RandomAccess<V>::update_coroutine(const std::vector<size_t> &positions, size_t group_size, Update update, Coroutine coroutine)
+{
+    interleave(positions.size(), group_size, [&](size_t i)
+               { return (this->*coroutine)(positions[i], i, update); });
+}
 
-        if (handle.done())
+template <typename V>
+void RandomAccess<V>::vectorized_put(const std::vector<size_t> &positions, const std::vector<V> &values)
+{
+    for (size_t i = 0; i < positions.size(); ++i)
+    {
+        data[positions[i]] = values[i];
+    }
+}
+
+template <typename V>
+void RandomAccess<V>::vectorized_put_gp(const std::vector<size_t> &positions, const std::vector<V> &values)
+{
+    update_gp(positions, [&](V &slot, size_t i)
+              { slot = values[i]; });
+}
+
+template <typename V>
+void RandomAccess<V>::vectorized_put_amac(const std::vector<size_t> &positions, const std::vector<V> &values, size_t group_size)
+{
+    update_amac(positions, group_size, [&](V &slot, size_t i)
+                { slot = values[i]; });
+}
+
+template <typename V>
+void RandomAccess<V>::vectorized_put_coroutine(const std::vector<size_t> &positions, const std::vector<V> &values, size_t group_size)
+{
+    auto put = [&](V &slot, size_t i)
+    { slot = values[i]; };
+    update_coroutine(positions, group_size, put, &RandomAccess::update_co<decltype(put)>);
+}
+
+template <typename V>
+void RandomAccess<V>::vectorized_put_coroutine_exp(const std::vector<size_t> &positions, const std::vector<V> &values, size_t group_size)
+{
+    auto put = [&](V &slot, size_t i)
+    { slot = values[i]; };
+    update_coroutine(positions, group_size, put, &RandomAccess::update_co_exp<decltype(put)>);
+}
+
+template <typename V>
+void RandomAccess<V>::vectorized_increment(const std::vector<size_t> &positions)
+{
+    for (auto pos : positions)
+    {
+        ++data[pos];
+    }
+}
+
+template <typename V>
+void RandomAccess<V>::vectorized_increment_gp(const std::vector<size_t> &positions)
+{
+    update_gp(positions, [](V &slot, size_t)
+              { ++slot; });
+}
+
+template <typename V>
+void RandomAccess<V>::vectorized_increment_amac(const std::vector<size_t> &positions, size_t group_size)
+{
+    update_amac(positions, group_size, [](V &slot, size_t)
+                { ++slot; });
+}
+
+template <typename V>
+void RandomAccess<V>::vectorized_increment_coroutine(const std::vector<size_t> &positions, size_t group_size)
+{
+    auto increment = [](V &slot, size_t)
+    { ++slot; };
+    update_coroutine(positions, group_size, increment, &RandomAccess::update_co<decltype(increment)>);
+}
+
+template <typename V>
+void RandomAccess<V>::vectorized_increment_coroutine_exp(const std::vector<size_t> &positions, size_t group_size)
+{
+    auto increment = [](V &slot, size_t)
+    { ++slot; };
+    update_coroutine(positions, group_size, increment, &RandomAccess::update_co_exp<decltype(increment)>);
+}
+
+enum class GatherIsa
+{
+    Scalar,
+    AVX2,
+    AVX512
+};
+
+static GatherIsa gather_isa()
+{
+    static const GatherIsa isa = []()
+    {
+#if defined(X86_64)
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx512f"))
         {
-            num_finished++;
-            handle.destroy();
-            if (i < positions.size())
-            {
-                handle = get_co(positions[i], results, i);
-                ++i;
-            }
-            else
-            {
-                handle = nullptr;
-                continue;
-            }
+            return GatherIsa::AVX512;
+        }
+        if (__builtin_cpu_supports("avx2"))
+        {
+            return GatherIsa::AVX2;
         }
+#endif
+        return GatherIsa::Scalar;
+    }();
+    return isa;
+}
 
-        handle.resume();
+const char *gather_instruction_set()
+{
+    switch (gather_isa())
+    {
+    case GatherIsa::AVX512:
+        return "avx512";
+    case GatherIsa::AVX2:
+        return "avx2";
+    default:
+        return "scalar";
     }
 }
 
+// A distance of 0 disables the prefetches.
 template <typename V>
-void RandomAccess<V>::vectorized_get_coroutine_exp(const std::vector<size_t> &positions, std::vector<V> &results, size_t group_size)
+inline void prefetch_ahead(const V *data, const size_t *positions, size_t i, size_t lanes, size_t count, size_t distance)
 {
-    CircularBuffer<std::coroutine_handle<promise>> buff(std::min(group_size, static_cast<size_t>(positions.size())));
+    if (distance == 0)
+    {
+        return;
+    }
+    for (size_t ahead = i + distance; ahead < std::min(i + distance + lanes, count); ++ahead)
+    {
+        __builtin_prefetch(data + positions[ahead], 0, 3);
+    }
+}
 
-    int num_finished = 0;
-    int i = 0;
+template <typename V>
+void gather_scalar(const V *data, const size_t *positions, V *results, size_t begin, size_t count, size_t distance)
+{
+    for (size_t i = begin; i < count; ++i)
+    {
+        prefetch_ahead(data, positions, i, 1, count, distance);
+        results[i] = data[positions[i]];
+    }
+}
 
-    while (num_finished < positions.size())
+#if defined(X86_64)
+template <typename V>
+__attribute__((target("avx2"))) void gather_avx2(const V *data, const size_t *positions, V *results, size_t count, size_t distance)
+{
+    constexpr size_t LANES = 4;
+    size_t i = 0;
+    for (; i + LANES <= count; i += LANES)
     {
-        std::coroutine_handle<promise> &handle = buff.next_state();
-        if (!handle)
+        prefetch_ahead(data, positions, i, LANES, count, distance);
+        __m256i index = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(positions + i));
+        if constexpr (sizeof(V) == 8)
+        {
+            _mm256_storeu_si256(reinterpret_cast<__m256i *>(results + i), _mm256_i64gather_epi64(reinterpret_cast<const long long *>(data), index, 8));
+        }
+        else if constexpr (sizeof(V) == 4)
+        {
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(results + i), _mm256_i64gather_epi32(reinterpret_cast<const int *>(data), index, 4));
+        }
+        else
         {
-            if (i < std::min(group_size, static_cast<size_t>(positions.size())))
+            alignas(16) uint32_t words[LANES];
+            _mm_store_si128(reinterpret_cast<__m128i *>(words), _mm256_i64gather_epi32(reinterpret_cast<const int *>(data), index, sizeof(V)));
+            for (size_t lane = 0; lane < LANES; ++lane)
             {
-                handle = get_co_exp(positions[i], results, i);
-                i++;
+                results[i + lane] = static_cast<V>(words[lane]);
             }
-            continue;
         }
+    }
+    gather_scalar(data, positions, results, i, count, distance);
+}
 
-        if (handle.done())
+template <typename V>
+__attribute__((target("avx512f"))) void gather_avx512(const V *data, const size_t *positions, V *results, size_t count, size_t distance)
+{
+    constexpr size_t LANES = 8;
+    size_t i = 0;
+    for (; i + LANES <= count; i += LANES)
+    {
+        prefetch_ahead(data, positions, i, LANES, count, distance);
+        __m512i index = _mm512_loadu_si512(positions + i);
+        if constexpr (sizeof(V) == 8)
         {
-            num_finished++;
-            handle.destroy();
-            if (i < positions.size())
-            {
-                handle = get_co_exp(positions[i], results, i);
-                ++i;
-            }
-            else
+            _mm512_storeu_si512(results + i, _mm512_i64gather_epi64(index, data, 8));
+        }
+        else if constexpr (sizeof(V) == 4)
+        {
+            _mm256_storeu_si256(reinterpret_cast<__m256i *>(results + i), _mm512_i64gather_epi32(index, data, 4));
+        }
+        else
+        {
+            alignas(32) uint32_t words[LANES];
+            _mm256_store_si256(reinterpret_cast<__m256i *>(words), _mm512_i64gather_epi32(index, data, sizeof(V)));
+            for (size_t lane = 0; lane < LANES; ++lane)
             {
-                handle = nullptr;
-                continue;
+                results[i + lane] = static_cast<V>(words[lane]);
             }
         }
+    }
+    gather_scalar(data, positions, results, i, count, distance);
+}
+#endif
 
-        handle.resume();
+template <typename V>
+void gather(const V *data, const std::vector<size_t> &positions, std::vector<V> &results, size_t distance)
+{
+    switch (gather_isa())
+    {
+#if defined(X86_64)
+    case GatherIsa::AVX512:
+        gather_avx512(data, positions.data(), results.data(), positions.size(), distance);
+        return;
+    case GatherIsa::AVX2:
+        gather_avx2(data, positions.data(), results.data(), positions.size(), distance);
+        return;
+#endif
+    default:
+        gather_scalar(data, positions.data(), results.data(), 0, positions.size(), distance);
     }
 }
 
+template <typename V>
+void RandomAccess<V>::vectorized_get_gather(const std::vector<size_t> &positions, std::vector<V> &results)
+{
+    gather(data.data(), positions, results, 0);
+}
+
+template <typename V>
+void RandomAccess<V>::vectorized_get_gather_prefetch(const std::vector<size_t> &positions, std::vector<V> &results, size_t distance)
+{
+    gather(data.data(), positions, results, distance);
+}
+
 template <typename V>
 size_t RandomAccess<V>::getSize() const
 {
     return num_elements;
 }
 
+template <typename V>
+size_t RandomAccess<V>::prefetch_distance() const
+{
+    return distance;
+}
+
+template <typename V>
+void RandomAccess<V>::set_prefetch_distance(size_t prefetch_distance)
+{
+    distance = std::max<size_t>(prefetch_distance, 1);
+}
+
+template <typename V>
+const void *RandomAccess<V>::address_of(size_t pos) const
+{
+    return data.data() + pos;
+}
+
 template class RandomAccess<uint8_t>;
 template class RandomAccess<uint16_t>;
 template class RandomAccess<uint32_t>;
@@ -1,17 +1,46 @@
 #include <stdint.h>
 #include <cstddef>
 #include <vector>
+#include <memory_resource>
 #include "coroutine.hpp"
 
+class WorkStealingExecutor;
+
+// Instruction set the gather kernels dispatch to on this CPU (avx512, avx2 or scalar).
+const char *gather_instruction_set();
+
 template <typename V>
 class RandomAccess
 {
 private:
-    V *data;
+    // 1 and 2 byte values are gathered as the 4 byte word starting at them, the padding keeps the last word in bounds.
+    static constexpr size_t GATHER_PADDING = sizeof(V) < sizeof(uint32_t) ? sizeof(uint32_t) / sizeof(V) : 0;
+
+    static constexpr size_t CALIBRATION_LOOKUPS = 1 << 16;
+    static constexpr size_t CALIBRATION_REPETITIONS = 5;
+    static constexpr size_t MAX_PREFETCH_DISTANCE = 64;
+
+    std::pmr::vector<V> data;
     size_t num_elements;
+    size_t distance = 1;
+
+    size_t calibrate_prefetch_distance();
+
+    // Update(V &slot, size_t i) applies the i-th write to its slot.
+    template <typename Update>
+    coroutine update_co(size_t pos, size_t i, Update &update);
+    template <typename Update>
+    coroutine update_co_exp(size_t pos, size_t i, Update &update);
+    template <typename Update>
+    void update_gp(const std::vector<size_t> &positions, Update update);
+    template <typename Update>
+    void update_amac(const std::vector<size_t> &positions, size_t group_size, Update update);
+    template <typename Update, typename Coroutine>
+    void update_coroutine(const std::vector<size_t> &positions, size_t group_size, Update update, Coroutine coroutine);
 
 public:
-    RandomAccess(size_t num_elements);
+    // The array is placed on memory_resource, e.g. a NumaMemoryResource to control its node and page size.
+    RandomAccess(size_t num_elements, std::pmr::memory_resource &memory_resource);
     V &get(size_t pos);
     coroutine get_co(size_t pos, std::vector<V> &results, int i);
     coroutine get_co_exp(size_t pos, std::vector<V> &results, int i);
@@ -19,6 +48,31 @@ public:
     void vectorized_get_gp(const std::vector<size_t> &positions, std::vector<V> &results);
     void vectorized_get_amac(const std::vector<size_t> &positions, std::vector<V> &results, size_t group_size);
     void vectorized_get_coroutine(const std::vector<size_t> &positions, std::vector<V> &results, size_t group_size);
+    // Spreads the batch over the workers of executor.
+    void vectorized_get_coroutine(const std::vector<size_t> &positions, std::vector<V> &results, size_t group_size, WorkStealingExecutor &executor);
     void vectorized_get_coroutine_exp(const std::vector<size_t> &positions, std::vector<V> &results, size_t group_size);
+    // Loads element i while the element prefetch_distance() lookups ahead is prefetched.
+    void vectorized_get_pipelined(const std::vector<size_t> &positions, std::vector<V> &results);
+    // Hardware gathers of 4 (AVX2) or 8 (AVX-512) elements, scalar loads on CPUs without them.
+    void vectorized_get_gather(const std::vector<size_t> &positions, std::vector<V> &results);
+    // Like vectorized_get_gather, but prefetches the elements distance positions ahead of the current gather.
+    void vectorized_get_gather_prefetch(const std::vector<size_t> &positions, std::vector<V> &results, size_t distance);
+    // Scattered writes, the interleaved variants prefetch with write intent so the lines arrive in exclusive state.
+    void vectorized_put(const std::vector<size_t> &positions, const std::vector<V> &values);
+    void vectorized_put_gp(const std::vector<size_t> &positions, const std::vector<V> &values);
+    void vectorized_put_amac(const std::vector<size_t> &positions, const std::vector<V> &values, size_t group_size);
+    void vectorized_put_coroutine(const std::vector<size_t> &positions, const std::vector<V> &values, size_t group_size);
+    void vectorized_put_coroutine_exp(const std::vector<size_t> &positions, const std::vector<V> &values, size_t group_size);
+    // Adds one to the element at every position, a position listed twice is incremented twice.
+    void vectorized_increment(const std::vector<size_t> &positions);
+    void vectorized_increment_gp(const std::vector<size_t> &positions);
+    void vectorized_increment_amac(const std::vector<size_t> &positions, size_t group_size);
+    void vectorized_increment_coroutine(const std::vector<size_t> &positions, size_t group_size);
+    void vectorized_increment_coroutine_exp(const std::vector<size_t> &positions, size_t group_size);
     size_t getSize() const;
+    // Distance of vectorized_get_pipelined, calibrated at construction to the fastest power of two up to 64.
+    size_t prefetch_distance() const;
+    void set_prefetch_distance(size_t prefetch_distance);
+    // Cache line a lookup of pos loads, used to sample the miss rate.
+    const void *address_of(size_t pos) const;
 };
\ No newline at end of file
@@ -0,0 +1,245 @@
+#include <stdexcept>
+
+#include "sharded_hashmap.hpp"
+#include "prefetching.hpp"
+#include "utils.cpp"
+
+template <typename K, typename V>
+ShardedHashMap<K, V>::ShardedHashMap(size_t capacity, PrefetchProfiler &profiler, size_t workers_per_node) : workers_per_node(workers_per_node), profiler(profiler)
+{
+    auto &manager = Prefetching::get().numa_manager;
+    nodes = manager.active_nodes;
+    if (nodes.empty() || workers_per_node == 0)
+    {
+        throw std::invalid_argument("ShardedHashMap requires at least one active NUMA node and worker.");
+    }
+
+    for (auto node : nodes)
+    {
+        memory_resources.push_back(std::make_unique<StaticNumaMemoryResource>(node));
+        shards.push_back(std::make_unique<HashMap<K, V>>(std::max(size_t{1}, capacity / nodes.size()), profiler, *memory_resources.back()));
+    }
+
+    for (size_t shard = 0; shard < shards.size(); ++shard)
+    {
+        auto &cpus = manager.node_to_available_cpus[nodes[shard]];
+        for (size_t w = 0; w < workers_per_node; ++w)
+        {
+            auto lane = std::make_unique<Lane>();
+            lane->shard = shard;
+            lane->cpu = cpus[w % cpus.size()];
+            lanes.push_back(std::move(lane));
+        }
+    }
+    for (auto &lane : lanes)
+    {
+        lane->worker = std::jthread([this, lane = lane.get()]()
+                                    { worker_loop(*lane); });
+    }
+}
+
+template <typename K, typename V>
+ShardedHashMap<K, V>::~ShardedHashMap()
+{
+    stop = true;
+    for (auto &lane : lanes)
+    {
+        lane->sequence.fetch_add(1, std::memory_order_release);
+        lane->sequence.notify_one();
+    }
+    for (auto &lane : lanes)
+    {
+        if (lane->worker.joinable())
+        {
+            lane->worker.join();
+        }
+    }
+}
+
+template <typename K, typename V>
+size_t ShardedHashMap<K, V>::shard_of(const K &key) const
+{
+    // Use other bits than HashMap::hash so that the keys of one shard still spread over all of its buckets.
+    uint64_t h = static_cast<uint64_t>(std::hash<K>{}(key)) * 0x9E3779B97F4A7C15ull;
+    return (h >> 32) % shards.size();
+}
+
+template <typename K, typename V>
+size_t ShardedHashMap<K, V>::lane_of(const K &key) const
+{
+    uint64_t h = static_cast<uint64_t>(std::hash<K>{}(key)) * 0x9E3779B97F4A7C15ull;
+    return ((h >> 32) % shards.size()) * workers_per_node + (h >> 16) % workers_per_node;
+}
+
+template <typename K, typename V>
+void ShardedHashMap<K, V>::worker_loop(Lane &lane)
+{
+    pin_to_cpu(lane.cpu);
+    uint64_t seen = 0;
+    while (true)
+    {
+        lane.sequence.wait(seen, std::memory_order_acquire);
+        seen = lane.sequence.load(std::memory_order_acquire);
+        if (stop)
+        {
+            return;
+        }
+
+        try
+        {
+            if (!lane.keys.empty())
+            {
+                lane.results.resize(lane.keys.size());
+                lane_function(*shards[lane.shard], lane.keys, lane.results);
+                auto &results = *batch_results;
+                for (size_t j = 0; j < lane.keys.size(); ++j)
+                {
+                    results[lane.positions[j]] = lane.results[j];
+                }
+            }
+        }
+        catch (...)
+        {
+            lane.exception = std::current_exception();
+        }
+
+        if (pending_lanes.fetch_sub(1, std::memory_order_acq_rel) == 1)
+        {
+            pending_lanes.notify_all();
+        }
+    }
+}
+
+template <typename K, typename V>
+void ShardedHashMap<K, V>::dispatch(const std::vector<K> &keys, std::vector<V> &results, LaneFunction function)
+{
+    // Radix partition: count the keys per lane, then scatter keys and their positions into the lanes.
+    std::vector<size_t> lane_ids(keys.size());
+    std::vector<size_t> counts(lanes.size(), 0);
+    for (size_t i = 0; i < keys.size(); ++i)
+    {
+        lane_ids[i] = lane_of(keys[i]);
+        counts[lane_ids[i]]++;
+    }
+    for (size_t l = 0; l < lanes.size(); ++l)
+    {
+        lanes[l]->keys.resize(counts[l]);
+        lanes[l]->positions.resize(counts[l]);
+        lanes[l]->exception = nullptr;
+        counts[l] = 0;
+    }
+    for (size_t i = 0; i < keys.size(); ++i)
+    {
+        auto &lane = *lanes[lane_ids[i]];
+        auto cursor = counts[lane_ids[i]]++;
+        lane.keys[cursor] = keys[i];
+        lane.positions[cursor] = i;
+    }
+
+    lane_function = std::move(function);
+    batch_results = &results;
+    pending_lanes.store(lanes.size(), std::memory_order_release);
+    for (auto &lane : lanes)
+    {
+        lane->sequence.fetch_add(1, std::memory_order_release);
+        lane->sequence.notify_one();
+    }
+
+    size_t pending;
+    while ((pending = pending_lanes.load(std::memory_order_acquire)) != 0)
+    {
+        pending_lanes.wait(pending, std::memory_order_acquire);
+    }
+
+    for (auto &lane : lanes)
+    {
+        if (lane->exception)
+        {
+            std::rethrow_exception(lane->exception);
+        }
+    }
+}
+
+template <typename K, typename V>
+void ShardedHashMap<K, V>::insert(const K &key, const V &value)
+{
+    shards[shard_of(key)]->insert(key, value);
+}
+
+template <typename K, typename V>
+V &ShardedHashMap<K, V>::get(const K &key)
+{
+    return shards[shard_of(key)]->get(key);
+}
+
+template <typename K, typename V>
+void ShardedHashMap<K, V>::vectorized_get(const std::vector<K> &keys, std::vector<V> &results)
+{
+    dispatch(keys, results, [](auto &shard, auto &lane_keys, auto &lane_results)
+             { shard.vectorized_get(lane_keys, lane_results); });
+}
+
+template <typename K, typename V>
+void ShardedHashMap<K, V>::vectorized_get_gp(const std::vector<K> &keys, std::vector<V> &results)
+{
+    dispatch(keys, results, [](auto &shard, auto &lane_keys, auto &lane_results)
+             { shard.vectorized_get_gp(lane_keys, lane_results); });
+}
+
+template <typename K, typename V>
+void ShardedHashMap<K, V>::vectorized_get_amac(const std::vector<K> &keys, std::vector<V> &results, int group_size)
+{
+    dispatch(keys, results, [group_size](auto &shard, auto &lane_keys, auto &lane_results)
+             { shard.vectorized_get_amac(lane_keys, lane_results, group_size); });
+}
+
+template <typename K, typename V>
+void ShardedHashMap<K, V>::vectorized_get_coroutine(const std::vector<K> &keys, std::vector<V> &results, int group_size)
+{
+    dispatch(keys, results, [group_size](auto &shard, auto &lane_keys, auto &lane_results)
+             { shard.vectorized_get_coroutine(lane_keys, lane_results, group_size); });
+}
+
+template <typename K, typename V>
+void ShardedHashMap<K, V>::vectorized_get_coroutine_exp(const std::vector<K> &keys, std::vector<V> &results, int group_size)
+{
+    dispatch(keys, results, [group_size](auto &shard, auto &lane_keys, auto &lane_results)
+             { shard.vectorized_get_coroutine_exp(lane_keys, lane_results, group_size); });
+}
+
+template <typename K, typename V>
+void ShardedHashMap<K, V>::remove(const K &key)
+{
+    shards[shard_of(key)]->remove(key);
+}
+
+template <typename K, typename V>
+bool ShardedHashMap<K, V>::contains(const K &key)
+{
+    return shards[shard_of(key)]->contains(key);
+}
+
+template <typename K, typename V>
+size_t ShardedHashMap<K, V>::getSize() const
+{
+    size_t size = 0;
+    for (auto &shard : shards)
+    {
+        size += shard->getSize();
+    }
+    return size;
+}
+
+template <typename K, typename V>
+bool ShardedHashMap<K, V>::isEmpty() const
+{
+    return getSize() == 0;
+}
+
+template <typename K, typename V>
+size_t ShardedHashMap<K, V>::num_shards() const
+{
+    return shards.size();
+}
+
+template class ShardedHashMap<unsigned int, unsigned int>;
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <thread>
+#include <atomic>
+#include <functional>
+#include <exception>
+
+#include "hashmap.hpp"
+#include "numa/static_numa_memory_resource.hpp"
+#include "types.hpp"
+
+/*
+    One HashMap shard per NUMA node, its buckets and nodes are placed on that node by a StaticNumaMemoryResource.
+    A batch is radix partitioned into lanes (one lane per worker thread), every worker is pinned to a CPU of its
+    shard's node, so all probes hit local DRAM. Workers scatter their results back into the caller's order.
+
+    A ShardedHashMap serves one batch at a time, the lane buffers are reused between batches.
+*/
+template <typename K, typename V>
+class ShardedHashMap
+{
+private:
+    using LaneFunction = std::function<void(HashMap<K, V> &, const std::vector<K> &, std::vector<V> &)>;
+
+    struct alignas(64) Lane
+    {
+        size_t shard;
+        NodeID cpu;
+        std::vector<K> keys;
+        std::vector<V> results;
+        std::vector<size_t> positions;
+        std::exception_ptr exception;
+        std::atomic<uint64_t> sequence{0};
+        std::jthread worker;
+    };
+
+    std::vector<NodeID> nodes;
+    std::vector<std::unique_ptr<StaticNumaMemoryResource>> memory_resources;
+    std::vector<std::unique_ptr<HashMap<K, V>>> shards;
+    std::vector<std::unique_ptr<Lane>> lanes;
+    size_t workers_per_node;
+
+    // Shared with the workers for the batch in flight.
+    LaneFunction lane_function;
+    std::vector<V> *batch_results = nullptr;
+    std::atomic<size_t> pending_lanes{0};
+    std::atomic<bool> stop{false};
+
+    size_t shard_of(const K &key) const;
+    size_t lane_of(const K &key) const;
+    void worker_loop(Lane &lane);
+    void dispatch(const std::vector<K> &keys, std::vector<V> &results, LaneFunction function);
+
+public:
+    PrefetchProfiler &profiler;
+
+    // Capacity is the total number of buckets, it is split evenly between the shards.
+    ShardedHashMap(size_t capacity, PrefetchProfiler &profiler, size_t workers_per_node = 1);
+    ~ShardedHashMap();
+    void insert(const K &key, const V &value);
+    V &get(const K &key);
+    void vectorized_get(const std::vector<K> &keys, std::vector<V> &results);
+    void vectorized_get_gp(const std::vector<K> &keys, std::vector<V> &results);
+    void vectorized_get_amac(const std::vector<K> &keys, std::vector<V> &results, int group_size);
+    void vectorized_get_coroutine(const std::vector<K> &keys, std::vector<V> &results, int group_size);
+    void vectorized_get_coroutine_exp(const std::vector<K> &keys, std::vector<V> &results, int group_size);
+    void remove(const K &key);
+    bool contains(const K &key);
+    size_t getSize() const;
+    bool isEmpty() const;
+    size_t num_shards() const;
+};
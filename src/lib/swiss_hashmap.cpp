@@ -0,0 +1,420 @@
+#include <bit>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+#if defined(X86_64)
+#include <emmintrin.h>
+#endif
+
+#include "swiss_hashmap.hpp"
+#include "utils.cpp"
+#include "interleave.hpp"
+
+ControlGroup::ControlGroup()
+{
+    std::memset(bytes, EMPTY, SWISS_GROUP_SIZE);
+}
+
+uint32_t ControlGroup::match(int8_t h2) const
+{
+#if defined(X86_64)
+    auto ctrl = _mm_load_si128(reinterpret_cast<const __m128i *>(bytes));
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8(h2), ctrl));
+#else
+    uint32_t mask = 0;
+    for (size_t i = 0; i < SWISS_GROUP_SIZE; ++i)
+    {
+        mask |= static_cast<uint32_t>(bytes[i] == h2) << i;
+    }
+    return mask;
+#endif
+}
+
+uint32_t ControlGroup::match_empty() const
+{
+    return match(EMPTY);
+}
+
+uint32_t ControlGroup::match_empty_or_deleted() const
+{
+    // Only empty and deleted slots have their most significant bit set.
+#if defined(X86_64)
+    return _mm_movemask_epi8(_mm_load_si128(reinterpret_cast<const __m128i *>(bytes)));
+#else
+    uint32_t mask = 0;
+    for (size_t i = 0; i < SWISS_GROUP_SIZE; ++i)
+    {
+        mask |= static_cast<uint32_t>(bytes[i] < 0) << i;
+    }
+    return mask;
+#endif
+}
+
+template <typename K, typename V>
+size_t SwissHashMap<K, V>::hash(const K &key)
+{
+    // std::hash is the identity for integers, mix the bits so that both H1 and H2 are usable.
+    uint64_t h = static_cast<uint64_t>(std::hash<K>{}(key)) * 0x9E3779B97F4A7C15ull;
+    return h ^ (h >> 32);
+}
+
+template <typename K, typename V>
+SwissHashMap<K, V>::SwissHashMap(size_t capacity, PrefetchProfiler &profiler, std::pmr::memory_resource &memory_resource) : size(0), profiler(profiler), memory_resource(memory_resource), control(&memory_resource), slots(&memory_resource)
+{
+    size_t num_groups = std::bit_ceil(std::max(size_t{1}, (capacity + SWISS_GROUP_SIZE - 1) / SWISS_GROUP_SIZE));
+    this->capacity = num_groups * SWISS_GROUP_SIZE;
+    group_mask = num_groups - 1;
+    control.resize(num_groups);
+    slots.resize(this->capacity);
+}
+
+template <typename K, typename V>
+SwissHashMap<K, V>::~SwissHashMap() {}
+
+template <typename K, typename V>
+size_t SwissHashMap<K, V>::slots_for(size_t num_keys, double fill_factor)
+{
+    return static_cast<size_t>(std::ceil(num_keys / fill_factor));
+}
+
+template <typename K, typename V>
+void SwissHashMap<K, V>::insert(const K &key, const V &value)
+{
+    size_t h = hash(key);
+    size_t group = h1(h) & group_mask;
+    size_t insert_slot = capacity;
+    for (size_t probes = 0; probes <= group_mask;)
+    {
+        auto &ctrl = control[group];
+        for (uint32_t candidates = ctrl.match(h2(h)); candidates; candidates &= candidates - 1)
+        {
+            auto &slot = slots[group * SWISS_GROUP_SIZE + std::countr_zero(candidates)];
+            if (slot.key == key)
+            {
+                slot.value = value;
+                return;
+            }
+        }
+        uint32_t free_slots = ctrl.match_empty_or_deleted();
+        if (insert_slot == capacity && free_slots)
+        {
+            insert_slot = group * SWISS_GROUP_SIZE + std::countr_zero(free_slots);
+        }
+        if (ctrl.match_empty())
+        {
+            break;
+        }
+        group = (group + ++probes) & group_mask;
+    }
+
+    if (insert_slot == capacity)
+    {
+        throw std::length_error("SwissHashMap is full");
+    }
+    control[insert_slot / SWISS_GROUP_SIZE].bytes[insert_slot % SWISS_GROUP_SIZE] = h2(h);
+    slots[insert_slot] = {key, value};
+    size++;
+}
+
+template <typename K, typename V>
+SwissSlot<K, V> *SwissHashMap<K, V>::find(const K &key)
+{
+    size_t h = hash(key);
+    size_t group = h1(h) & group_mask;
+    for (size_t probes = 0; probes <= group_mask;)
+    {
+        auto &ctrl = control[group];
+        for (uint32_t candidates = ctrl.match(h2(h)); candidates; candidates &= candidates - 1)
+        {
+            auto &slot = slots[group * SWISS_GROUP_SIZE + std::countr_zero(candidates)];
+            if (slot.key == key)
+            {
+                return &slot;
+            }
+        }
+        if (ctrl.match_empty())
+        {
+            break;
+        }
+        group = (group + ++probes) & group_mask;
+    }
+    return nullptr;
+}
+
+template <typename K, typename V>
+V &SwissHashMap<K, V>::get(const K &key)
+{
+    auto slot = find(key);
+    if (!slot)
+    {
+        throw std::out_of_range("Key not found");
+    }
+    return slot->value;
+}
+
+template <typename K, typename V>
+void SwissHashMap<K, V>::vectorized_get(const std::vector<K> &keys, std::vector<V> &results)
+{
+    int i = 0;
+    for (auto &key : keys)
+    {
+        results.at(i) = get(key);
+        i++;
+    }
+}
+
+template <typename K, typename V>
+void SwissHashMap<K, V>::vectorized_get_gp(const std::vector<K> &keys, std::vector<V> &results)
+{
+    // Every key is processed as AMAC_state, but all keys advance in lock step.
+    // stages:
+    //  1: Control group prefetched, match fingerprint
+    //  2: Candidate slot prefetched, compare key
+    //  0: Finished, element found
+    std::vector<AMAC_state> states(keys.size());
+    for (int i = 0; i < keys.size(); i++)
+    {
+        auto &state = states[i];
+        size_t h = hash(keys[i]);
+        state.key = keys[i];
+        state.group = h1(h) & group_mask;
+        state.fingerprint = h2(h);
+        state.probes = 0;
+        state.stage = 1;
+        __builtin_prefetch(&control[state.group], 0, 3);
+    }
+
+    int finished = 0;
+    while (finished < keys.size())
+    {
+        for (int i = 0; i < keys.size(); i++)
+        {
+            auto &state = states[i];
+            if (state.stage == 1)
+            {
+                state.candidates = control[state.group].match(state.fingerprint);
+                state.stage = 2;
+            }
+            else if (state.stage == 2)
+            {
+                auto &slot = slots[state.group * SWISS_GROUP_SIZE + std::countr_zero(state.candidates)];
+                if (slot.key == state.key)
+                {
+                    results[i] = slot.value;
+                    state.stage = 0;
+                    ++finished;
+                    continue;
+                }
+                state.candidates &= state.candidates - 1;
+            }
+            else
+            {
+                // Finished processing this key
+                continue;
+            }
+
+            if (state.candidates)
+            {
+                __builtin_prefetch(&slots[state.group * SWISS_GROUP_SIZE + std::countr_zero(state.candidates)], 0, 3);
+                continue;
+            }
+            if (control[state.group].match_empty() || state.probes == group_mask)
+            {
+                throw std::out_of_range("Key not found.");
+            }
+            state.group = (state.group + ++state.probes) & group_mask;
+            state.stage = 1;
+            __builtin_prefetch(&control[state.group], 0, 3);
+        }
+    }
+}
+
+template <typename K, typename V>
+void SwissHashMap<K, V>::vectorized_get_amac(const std::vector<K> &keys, std::vector<V> &results, int group_size)
+{
+    CircularBuffer<AMAC_state> buff(group_size);
+
+    int num_finished = 0;
+    int i = 0;
+    while (num_finished < keys.size())
+    {
+        AMAC_state &state = buff.next_state();
+
+        if (state.stage == 0)
+        {
+            if (i >= keys.size())
+            {
+                continue;
+            }
+            size_t h = hash(keys[i]);
+            state.i = i;
+            state.key = keys[i++];
+            state.group = h1(h) & group_mask;
+            state.fingerprint = h2(h);
+            state.probes = 0;
+            state.stage = 1;
+            __builtin_prefetch(&control[state.group], 0, 3);
+            continue;
+        }
+
+        if (state.stage == 1)
+        {
+            state.candidates = control[state.group].match(state.fingerprint);
+        }
+        else if (state.stage == 2)
+        {
+            auto &slot = slots[state.group * SWISS_GROUP_SIZE + std::countr_zero(state.candidates)];
+            if (slot.key == state.key)
+            {
+                state.stage = 0;
+                results[state.i] = slot.value;
+                num_finished++;
+                continue;
+            }
+            state.candidates &= state.candidates - 1;
+        }
+
+        if (state.candidates)
+        {
+            state.stage = 2;
+            __builtin_prefetch(&slots[state.group * SWISS_GROUP_SIZE + std::countr_zero(state.candidates)], 0, 3);
+        }
+        else
+        {
+            if (control[state.group].match_empty() || state.probes == group_mask)
+            {
+                throw std::out_of_range("Key not found.");
+            }
+            state.group = (state.group + ++state.probes) & group_mask;
+            state.stage = 1;
+            __builtin_prefetch(&control[state.group], 0, 3);
+        }
+    }
+}
+
+template <typename K, typename V>
+coroutine SwissHashMap<K, V>::get_co(const K &key, std::vector<V> &results, const int i)
+{
+    size_t h = hash(key);
+    size_t group = h1(h) & group_mask;
+    for (size_t probes = 0; probes <= group_mask;)
+    {
+        // prefetch control bytes of the group
+        __builtin_prefetch(&control[group], 0, 3);
+        co_await std::suspend_always{};
+
+        for (uint32_t candidates = control[group].match(h2(h)); candidates; candidates &= candidates - 1)
+        {
+            auto &slot = slots[group * SWISS_GROUP_SIZE + std::countr_zero(candidates)];
+            __builtin_prefetch(&slot, 0, 3);
+            co_await std::suspend_always{};
+            if (slot.key == key)
+            {
+                results.at(i) = slot.value;
+                co_return;
+            }
+        }
+        if (control[group].match_empty())
+        {
+            break;
+        }
+        group = (group + ++probes) & group_mask;
+    }
+    throw std::out_of_range("Key not found");
+}
+
+template <typename K, typename V>
+coroutine SwissHashMap<K, V>::get_co_exp(const K &key, std::vector<V> &results, const int i)
+{
+    size_t h = hash(key);
+    size_t group = h1(h) & group_mask;
+    for (size_t probes = 0; probes <= group_mask;)
+    {
+        if (!is_in_tlb_and_prefetch(&control[group]))
+        {
+            co_await std::suspend_always{};
+        }
+
+        for (uint32_t candidates = control[group].match(h2(h)); candidates; candidates &= candidates - 1)
+        {
+            auto &slot = slots[group * SWISS_GROUP_SIZE + std::countr_zero(candidates)];
+            if (!is_in_tlb_and_prefetch(&slot))
+            {
+                co_await std::suspend_always{};
+            }
+            if (slot.key == key)
+            {
+                results.at(i) = slot.value;
+                co_return;
+            }
+        }
+        if (control[group].match_empty())
+        {
+            break;
+        }
+        group = (group + ++probes) & group_mask;
+    }
+    throw std::out_of_range("Key not found");
+}
+
+template <typename K, typename V>
+void SwissHashMap<K, V>::vectorized_get_coroutine(const std::vector<K> &keys, std::vector<V> &results, int group_size)
+{
+    interleave(keys.size(), group_size, [&](size_t i)
+               { return get_co(keys[i], results, i); });
+}
+
+template <typename K, typename V>
+void SwissHashMap<K, V>::vectorized_get_coroutine_exp(const std::vector<K> &keys, std::vector<V> &results, int group_size)
+{
+    interleave(keys.size(), group_size, [&](size_t i)
+               { return get_co_exp(keys[i], results, i); });
+}
+
+template <typename K, typename V>
+void SwissHashMap<K, V>::remove(const K &key)
+{
+    size_t h = hash(key);
+    size_t group = h1(h) & group_mask;
+    for (size_t probes = 0; probes <= group_mask;)
+    {
+        auto &ctrl = control[group];
+        for (uint32_t candidates = ctrl.match(h2(h)); candidates; candidates &= candidates - 1)
+        {
+            auto offset = std::countr_zero(candidates);
+            if (slots[group * SWISS_GROUP_SIZE + offset].key == key)
+            {
+                // Lookups stop at a group with an empty slot anyway, so only groups without one need a tombstone.
+                ctrl.bytes[offset] = ctrl.match_empty() ? ControlGroup::EMPTY : ControlGroup::DELETED;
+                size--;
+                return;
+            }
+        }
+        if (ctrl.match_empty())
+        {
+            break;
+        }
+        group = (group + ++probes) & group_mask;
+    }
+    throw std::out_of_range("Key not found");
+}
+
+template <typename K, typename V>
+bool SwissHashMap<K, V>::contains(const K &key)
+{
+    return find(key) != nullptr;
+}
+
+template <typename K, typename V>
+size_t SwissHashMap<K, V>::getSize() const
+{
+    return size;
+}
+
+template <typename K, typename V>
+bool SwissHashMap<K, V>::isEmpty() const
+{
+    return size == 0;
+}
+
+template class SwissHashMap<unsigned int, unsigned int>;
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <iostream>
+#include <vector>
+#include <coroutine>
+#include <cstdint>
+#include <assert.h>
+
+#include "coroutine.hpp"
+#include "utils/profiler.cpp"
+#include "numa/numa_memory_resource.hpp"
+
+constexpr size_t SWISS_GROUP_SIZE = 16;
+
+/*
+    One control byte per slot: the most significant bit tells empty/deleted slots apart from full ones, the
+    remaining 7 bits of a full slot hold a fingerprint (H2) of the key's hash. All 16 control bytes of a group
+    are compared against the fingerprint in a single SSE2 instruction, so only slots whose fingerprint matches
+    have to be fetched.
+*/
+struct alignas(SWISS_GROUP_SIZE) ControlGroup
+{
+    static constexpr int8_t EMPTY = -128;  // 0b10000000
+    static constexpr int8_t DELETED = -2;  // 0b11111110
+
+    int8_t bytes[SWISS_GROUP_SIZE];
+
+    ControlGroup();
+    // Bitmask of the slots whose control byte equals h2.
+    uint32_t match(int8_t h2) const;
+    uint32_t match_empty() const;
+    uint32_t match_empty_or_deleted() const;
+};
+
+template <typename K, typename V>
+struct SwissSlot
+{
+    K key;
+    V value;
+};
+
+template <typename K, typename V>
+class SwissHashMap
+{
+private:
+    std::pmr::vector<ControlGroup> control;
+    std::pmr::vector<SwissSlot<K, V>> slots;
+    size_t size;
+    size_t capacity;
+    size_t group_mask;
+    std::pmr::memory_resource &memory_resource;
+
+    size_t hash(const K &key);
+    static size_t h1(size_t hash) { return hash >> 7; }
+    static int8_t h2(size_t hash) { return hash & 0x7F; }
+    SwissSlot<K, V> *find(const K &key);
+
+    struct AMAC_state
+    {
+        K key;
+        size_t group;
+        size_t probes;
+        uint32_t candidates;
+        int8_t fingerprint;
+        int stage = 0;
+        int i;
+    };
+
+public:
+    PrefetchProfiler &profiler;
+
+    // Capacity is the number of slots. It is rounded up to a power of two number of groups.
+    SwissHashMap(size_t capacity, PrefetchProfiler &profiler, std::pmr::memory_resource &memory_resource);
+    ~SwissHashMap();
+    void insert(const K &key, const V &value);
+    V &get(const K &key);
+    coroutine get_co(const K &key, std::vector<V> &results, int i);
+    coroutine get_co_exp(const K &key, std::vector<V> &results, int i);
+    void vectorized_get(const std::vector<K> &keys, std::vector<V> &results);
+    void vectorized_get_gp(const std::vector<K> &keys, std::vector<V> &results);
+    void vectorized_get_amac(const std::vector<K> &keys, std::vector<V> &results, int group_size);
+    void vectorized_get_coroutine(const std::vector<K> &keys, std::vector<V> &results, int group_size);
+    void vectorized_get_coroutine_exp(const std::vector<K> &keys, std::vector<V> &results, int group_size);
+    void remove(const K &key);
+    bool contains(const K &key);
+    size_t getSize() const;
+    bool isEmpty() const;
+
+    // Number of slots required to hold num_keys keys at the given fill factor.
+    static size_t slots_for(size_t num_keys, double fill_factor = 0.875);
+};
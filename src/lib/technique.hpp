@@ -0,0 +1,134 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <stdexcept>
+
+// The ways a batch of lookups can be executed, from one lookup after the other to interleaved coroutines.
+enum class Technique
+{
+    Plain,
+    GP,
+    AMAC,
+    Coroutine,
+    CoroutineExp
+};
+
+inline Technique parse_technique(const std::string &name)
+{
+    if (name == "plain")
+    {
+        return Technique::Plain;
+    }
+    else if (name == "gp")
+    {
+        return Technique::GP;
+    }
+    else if (name == "amac")
+    {
+        return Technique::AMAC;
+    }
+    else if (name == "coroutine")
+    {
+        return Technique::Coroutine;
+    }
+    else if (name == "coroutine_exp")
+    {
+        return Technique::CoroutineExp;
+    }
+    throw std::invalid_argument("Unknown technique: " + name);
+}
+
+inline std::string technique_name(Technique technique)
+{
+    switch (technique)
+    {
+    case Technique::Plain:
+        return "plain";
+    case Technique::GP:
+        return "gp";
+    case Technique::AMAC:
+        return "amac";
+    case Technique::Coroutine:
+        return "coroutine";
+    case Technique::CoroutineExp:
+        return "coroutine_exp";
+    }
+    return "unknown";
+}
+
+// Reused between batches by run_technique, GP runs on copies of the chunks of group_size keys.
+template <typename Key, typename Value>
+struct TechniqueBuffers
+{
+    std::vector<Key> keys;
+    std::vector<Value> results;
+    std::vector<bool> found;
+};
+
+// Executes a batch of lookups (vectorized_get*) of a structure with the given technique. GP prefetches its whole
+// input at once, so it runs on chunks of group_size keys.
+template <typename Structure, typename Key, typename Value>
+void run_technique(Structure &structure, Technique technique, const std::vector<Key> &keys, std::vector<Value> &results, size_t group_size, TechniqueBuffers<Key, Value> &buffers)
+{
+    switch (technique)
+    {
+    case Technique::Plain:
+        structure.vectorized_get(keys, results);
+        break;
+    case Technique::GP:
+        for (size_t offset = 0; offset < keys.size(); offset += group_size)
+        {
+            size_t end = std::min(offset + group_size, keys.size());
+            buffers.keys.assign(keys.begin() + offset, keys.begin() + end);
+            buffers.results.resize(buffers.keys.size());
+            structure.vectorized_get_gp(buffers.keys, buffers.results);
+            std::copy(buffers.results.begin(), buffers.results.end(), results.begin() + offset);
+        }
+        break;
+    case Technique::AMAC:
+        structure.vectorized_get_amac(keys, results, group_size);
+        break;
+    case Technique::Coroutine:
+        structure.vectorized_get_coroutine(keys, results, group_size);
+        break;
+    case Technique::CoroutineExp:
+        structure.vectorized_get_coroutine_exp(keys, results, group_size);
+        break;
+    }
+}
+
+// Same for lookups that may miss (vectorized_find*), returns the number of keys found.
+template <typename Structure, typename Key, typename Value>
+size_t run_technique(Structure &structure, Technique technique, const std::vector<Key> &keys, std::vector<Value> &results, std::vector<bool> &found, size_t group_size, TechniqueBuffers<Key, Value> &buffers)
+{
+    switch (technique)
+    {
+    case Technique::Plain:
+        return structure.vectorized_find(keys, results, found);
+    case Technique::GP:
+    {
+        size_t num_found = 0;
+        results.resize(keys.size());
+        found.assign(keys.size(), false);
+        for (size_t offset = 0; offset < keys.size(); offset += group_size)
+        {
+            size_t end = std::min(offset + group_size, keys.size());
+            buffers.keys.assign(keys.begin() + offset, keys.begin() + end);
+            buffers.results.resize(buffers.keys.size());
+            num_found += structure.vectorized_find_gp(buffers.keys, buffers.results, buffers.found);
+            std::copy(buffers.results.begin(), buffers.results.begin() + buffers.keys.size(), results.begin() + offset);
+            std::copy(buffers.found.begin(), buffers.found.begin() + buffers.keys.size(), found.begin() + offset);
+        }
+        return num_found;
+    }
+    case Technique::AMAC:
+        return structure.vectorized_find_amac(keys, results, found, group_size);
+    case Technique::Coroutine:
+        return structure.vectorized_find_coroutine(keys, results, found, group_size);
+    case Technique::CoroutineExp:
+        return structure.vectorized_find_coroutine_exp(keys, results, found, group_size);
+    }
+    return 0;
+}
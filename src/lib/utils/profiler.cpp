@@ -23,8 +23,8 @@ public:
     std::vector<StepSpecifier> classifications;
     std::vector<uint16_t> latencies;
     uint64_t latency_sampling_mask = 1023; // store every sampling_mask-th latency
-    uint64_t sampling_counter;
-    size_t latency_insert;
+    uint64_t sampling_counter = 0;
+    size_t latency_insert = 0;
 
     PrefetchProfiler(int maxPrefetches = 30, int num_latencies = 1000)
     {
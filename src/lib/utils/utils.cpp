@@ -1,3 +1,5 @@
+#pragma once
+
 #include <stdint.h>
 #if defined(X86_64)
 #include <x86intrin.h>
@@ -14,7 +16,7 @@
 #include "profiler.cpp"
 #include "../types.hpp"
 
-void wait_cycles(uint64_t x)
+inline void wait_cycles(uint64_t x)
 {
     for (int i = 0; i < x; ++i)
     {
@@ -59,6 +61,24 @@ const uint64_t l1_prefetch_latency = 44;
 
 static uint64_t sampling_counter = 0;
 
+// Prefetches the line of ptr into L1, with RW = 1 with write intent (PREFETCHW) so it arrives in exclusive state.
+// __builtin_prefetch(ptr, 1, 3) only emits PREFETCHW if the compiler targets PRFCHW and falls back to PREFETCHT0
+// otherwise, the instruction is emitted directly since x86 CPUs without PRFCHW execute it as a NOP.
+template <int RW = 0>
+inline void prefetch_line(const void *ptr)
+{
+#if defined(X86_64)
+    if constexpr (RW == 1)
+    {
+        asm volatile("prefetchw %0" ::"m"(*static_cast<const char *>(ptr)));
+        return;
+    }
+#endif
+    __builtin_prefetch(ptr, RW, 3);
+}
+
+// With RW = 1 the line is prefetched with write intent (PREFETCHW).
+template <int RW = 0>
 inline bool is_in_tlb_and_prefetch(const void *ptr)
 {
     uint64_t start, end;
@@ -67,7 +87,7 @@ inline bool is_in_tlb_and_prefetch(const void *ptr)
     lfence();
     asm volatile("" ::: "memory");
 
-    __builtin_prefetch(ptr, 0, 3); // Prefetch to L1 cache
+    prefetch_line<RW>(ptr); // Prefetch to L1 cache
 
     asm volatile("" ::: "memory");
     lfence();
@@ -134,7 +154,7 @@ public:
     }
 };
 
-void pin_to_cpu(NodeID cpu)
+inline void pin_to_cpu(NodeID cpu)
 {
     cpu_set_t cpuset;
     CPU_ZERO(&cpuset);
@@ -146,7 +166,7 @@ void pin_to_cpu(NodeID cpu)
     }
 };
 
-void initialize_pointer_chase(uint64_t *data, size_t size)
+inline void initialize_pointer_chase(uint64_t *data, size_t size)
 {
     std::vector<uint64_t> random_numbers(size);
 
@@ -216,7 +236,7 @@ inline std::uint32_t murmur_32(std::uint32_t val)
 
 // --- End "Work" ---
 
-size_t align_to_power_of_floor(size_t p, size_t align)
+inline size_t align_to_power_of_floor(size_t p, size_t align)
 {
     return p & ~(align - 1);
 }
@@ -257,7 +277,7 @@ auto findMedian(std::vector<c> &container,
     }
 }
 
-auto get_steady_clock_min_duration(size_t repetitions)
+inline auto get_steady_clock_min_duration(size_t repetitions)
 {
     // warm up
     for (size_t i = 0; i < 50'000'000; ++i)
@@ -1,8 +1,12 @@
 #include <list>
 #include <iostream>
 #include <memory_resource>
+#include <set>
+#include <cstdlib>
 
 #include "numa/static_numa_memory_resource.hpp"
+#include "numa/slab_memory_resource.hpp"
+#include "hashmap.hpp"
 
 class Test
 {
@@ -19,6 +23,35 @@ public:
     V value;
 };
 
+// Forwards to new/delete and counts what reaches it.
+class CountingResource : public std::pmr::memory_resource
+{
+public:
+    size_t allocations = 0;
+    size_t deallocations = 0;
+
+    void *do_allocate(std::size_t bytes, std::size_t alignment) override
+    {
+        allocations++;
+        return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+    }
+    void do_deallocate(void *p, std::size_t bytes, std::size_t alignment) override
+    {
+        deallocations++;
+        std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+    }
+    bool do_is_equal(const memory_resource &other) const noexcept override { return &other == this; }
+};
+
+void check(bool condition, const char *what)
+{
+    if (!condition)
+    {
+        std::cout << "FAILED: " << what << std::endl;
+        std::exit(1);
+    }
+}
+
 int main()
 {
     StaticNumaMemoryResource mem_res{0};
@@ -90,5 +123,120 @@ int main()
     {
         test5[0].emplace_back(0l, 0l);
     }
+
+    // --- Test 6 -> SlabMemoryResource allocating and freeing across slab boundaries ---
+    std::cout << "--- Test 6 ---" << std::endl;
+
+    constexpr size_t SLAB_SIZE = 4096;
+    constexpr size_t OBJECT_SIZE = 64;
+    constexpr size_t SLOTS_PER_SLAB = (SLAB_SIZE - 64) / OBJECT_SIZE;
+    {
+        CountingResource upstream;
+        SlabMemoryResource slab_res{OBJECT_SIZE, upstream, SLAB_SIZE};
+
+        std::vector<void *> objects;
+        for (size_t i = 0; i < 3 * SLOTS_PER_SLAB + 1; ++i)
+        {
+            objects.push_back(slab_res.allocate(OBJECT_SIZE, alignof(std::max_align_t)));
+        }
+        check(slab_res.slab_count() == 4, "one slab per SLOTS_PER_SLAB objects");
+        check(std::set<void *>(objects.begin(), objects.end()).size() == objects.size(), "distinct slots");
+        for (auto *p : objects)
+        {
+            check(reinterpret_cast<uintptr_t>(p) % SLAB_SIZE >= 64, "slots never overlap the slab header");
+            slab_res.deallocate(p, OBJECT_SIZE, alignof(std::max_align_t));
+        }
+        for (size_t i = 0; i < objects.size(); ++i)
+        {
+            slab_res.allocate(OBJECT_SIZE, alignof(std::max_align_t));
+        }
+        check(slab_res.slab_count() == 4, "freed slots are reused");
+    }
+
+    // --- Test 7 -> SlabMemoryResource compaction ---
+    std::cout << "--- Test 7 ---" << std::endl;
+    {
+        CountingResource upstream;
+        SlabMemoryResource slab_res{OBJECT_SIZE, upstream, SLAB_SIZE};
+
+        std::vector<void *> first, second;
+        for (size_t i = 0; i < SLOTS_PER_SLAB; ++i)
+        {
+            first.push_back(slab_res.allocate(OBJECT_SIZE, alignof(std::max_align_t)));
+        }
+        for (size_t i = 0; i < SLOTS_PER_SLAB; ++i)
+        {
+            second.push_back(slab_res.allocate(OBJECT_SIZE, alignof(std::max_align_t)));
+        }
+        std::set<void *> freed(first.begin(), first.end());
+        for (auto *p : first)
+        {
+            slab_res.deallocate(p, OBJECT_SIZE, alignof(std::max_align_t));
+        }
+
+        slab_res.begin_compaction();
+        for (size_t i = 0; i < SLOTS_PER_SLAB; ++i)
+        {
+            check(!freed.count(slab_res.allocate(OBJECT_SIZE, alignof(std::max_align_t))), "no freed slot is reused during the compaction");
+        }
+        check(slab_res.slab_count() == 3, "the compaction bumps onto a fresh slab");
+        size_t deallocations = upstream.deallocations;
+        slab_res.end_compaction();
+        check(slab_res.slab_count() == 2, "the empty slab is released");
+        check(upstream.deallocations == deallocations + 1, "the empty slab goes back to upstream");
+
+        // The free slots of the released slab are gone, new objects come from the remaining slabs.
+        for (size_t i = 0; i < SLOTS_PER_SLAB; ++i)
+        {
+            check(!freed.count(slab_res.allocate(OBJECT_SIZE, alignof(std::max_align_t))), "no slot of a released slab is handed out");
+        }
+    }
+
+    // --- Test 8 -> SlabMemoryResource forwarding requests it does not pool ---
+    std::cout << "--- Test 8 ---" << std::endl;
+    {
+        CountingResource upstream;
+        SlabMemoryResource slab_res{OBJECT_SIZE, upstream, SLAB_SIZE};
+
+        void *large = slab_res.allocate(4 * OBJECT_SIZE, alignof(std::max_align_t));
+        check(upstream.allocations == 1 && slab_res.slab_count() == 0, "large requests go to upstream");
+        slab_res.deallocate(large, 4 * OBJECT_SIZE, alignof(std::max_align_t));
+        check(upstream.deallocations == 1, "large requests are freed on upstream");
+
+        void *aligned = slab_res.allocate(OBJECT_SIZE, 2 * SLAB_SIZE);
+        check(reinterpret_cast<uintptr_t>(aligned) % (2 * SLAB_SIZE) == 0 && slab_res.slab_count() == 0, "overaligned requests go to upstream");
+        slab_res.deallocate(aligned, OBJECT_SIZE, 2 * SLAB_SIZE);
+    }
+
+    // --- Test 9 -> HashMap::compact() on a SlabMemoryResource ---
+    std::cout << "--- Test 9 ---" << std::endl;
+    {
+        using Map = HashMap<uint32_t, uint32_t>;
+        CountingResource upstream;
+        SlabMemoryResource slab_res{Map::NODE_SIZE, upstream, SLAB_SIZE};
+        PrefetchProfiler profiler;
+        Map map{1024, profiler, slab_res};
+
+        constexpr uint32_t NUM_KEYS = 20000;
+        for (uint32_t key = 0; key < NUM_KEYS; ++key)
+        {
+            map.insert(key, key + 1);
+        }
+        for (uint32_t key = 0; key < NUM_KEYS; key += 3)
+        {
+            map.remove(key);
+        }
+        size_t slabs = slab_res.slab_count();
+        map.compact();
+        check(slab_res.slab_count() <= slabs, "compaction does not grow the slabs");
+        for (uint32_t key = 0; key < NUM_KEYS; ++key)
+        {
+            check(map.contains(key) == (key % 3 != 0), "compaction keeps exactly the present keys");
+            if (key % 3 != 0)
+            {
+                check(map.get(key) == key + 1, "compaction keeps the values");
+            }
+        }
+    }
     return 0;
 }
\ No newline at end of file
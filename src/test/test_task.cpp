@@ -0,0 +1,108 @@
+#include <coroutine>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <cstdlib>
+
+#include "coroutine.hpp"
+
+void check(bool condition, const char *what)
+{
+    if (!condition)
+    {
+        std::cout << "FAILED: " << what << std::endl;
+        std::exit(1);
+    }
+}
+
+int leaf_suspensions = 0;
+
+// Suspends like a lookup that issued a prefetch.
+task<int> leaf(int value, int suspensions)
+{
+    for (int i = 0; i < suspensions; ++i)
+    {
+        leaf_suspensions++;
+        co_await std::suspend_always{};
+    }
+    co_return value;
+}
+
+task<int> middle(int value)
+{
+    int inner = co_await leaf(value, 2);
+    co_return inner + 1;
+}
+
+task<int> outer(int value)
+{
+    int first = co_await middle(value);
+    int second = co_await leaf(value, 0);
+    co_return first + second;
+}
+
+task<int> throwing_leaf()
+{
+    co_await std::suspend_always{};
+    throw std::runtime_error("leaf failed");
+}
+
+task<void> throwing_outer()
+{
+    co_await middle(1);
+    co_await throwing_leaf();
+}
+
+// Resumes the task like a scheduler and returns how often control came back before it finished.
+template <typename T>
+int run(task<T> &t)
+{
+    int resumes = 0;
+    while (!t.done())
+    {
+        t.resume();
+        resumes++;
+    }
+    return resumes;
+}
+
+int main()
+{
+    // --- Test 1 -> A suspension of the leaf of a chain returns to the scheduler ---
+    std::cout << "--- Test 1 ---" << std::endl;
+    {
+        auto t = outer(20);
+        t.resume();
+        check(!t.done() && leaf_suspensions == 1, "the first leaf suspension returns to the scheduler");
+        t.resume();
+        check(!t.done() && leaf_suspensions == 2, "the resumed leaf suspends again");
+        t.resume();
+        check(t.done(), "the chain finishes without further suspensions");
+    }
+
+    // --- Test 2 -> Nested co_await yields the co_return value of the inner task ---
+    std::cout << "--- Test 2 ---" << std::endl;
+    {
+        auto t = outer(20);
+        check(run(t) == 3, "one resume per leaf suspension plus the start");
+        check(t.result() == 41, "the outer task combines the values of its inner tasks");
+    }
+
+    // --- Test 3 -> An exception of an inner task is rethrown from result() ---
+    std::cout << "--- Test 3 ---" << std::endl;
+    {
+        auto t = throwing_outer();
+        run(t);
+        bool thrown = false;
+        try
+        {
+            t.result();
+        }
+        catch (const std::runtime_error &e)
+        {
+            thrown = std::string(e.what()) == "leaf failed";
+        }
+        check(thrown, "result() rethrows the exception of the inner task");
+    }
+    return 0;
+}